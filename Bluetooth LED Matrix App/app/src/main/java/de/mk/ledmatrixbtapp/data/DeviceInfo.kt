@@ -0,0 +1,69 @@
+package de.mk.ledmatrixbtapp.data
+
+/**
+ * The capabilities of the LED matrix, as reported by the GET_INFO command.
+ *
+ * @property version The version of the Bluetooth protocol.
+ * @property width The width of the matrix in pixels.
+ * @property height The height of the matrix in pixels.
+ * @property ledCount The number of LEDs of the matrix.
+ * @property burst The number of bytes that may be sent without waiting for a response.
+ * @property idleTimeout The time in milliseconds without data after which the device considers a command complete.
+ * @property commands Bit n is set if command n is supported.
+ * @property showTime The time in microseconds the device needs to send a frame to the LEDs.
+ */
+data class DeviceInfo(
+    val version: Int,
+    val width: Int,
+    val height: Int,
+    val ledCount: Int,
+    val burst: Int,
+    val idleTimeout: Int,
+    val commands: Long,
+    val showTime: Int,
+) {
+    /**
+     * Check whether the device supports a command.
+     *
+     * @param code The code of the command.
+     * @return True if the command is supported.
+     */
+    fun supports(code: Byte) = (commands shr code.toInt()) and 1L == 1L
+
+    companion object {
+        /**
+         * The capabilities assumed for devices that do not support GET_INFO:
+         * an 8x8 matrix that only supports the original commands and is sent at most 16 LEDs at once.
+         */
+        val DEFAULT = DeviceInfo(
+            version = 1,
+            width = 8,
+            height = 8,
+            ledCount = 64,
+            burst = 1 + 16 * 4,
+            idleTimeout = 0,
+            commands = 0b1110,
+            showTime = 0,
+        )
+
+        /**
+         * Parse the payload of a GET_INFO response.
+         *
+         * @param data The response without the command and status bytes.
+         * @return The capabilities of the device, or null if the payload is too short.
+         */
+        fun parse(data: List<Int>): DeviceInfo? {
+            if (data.size < 13) return null
+            return DeviceInfo(
+                version = data[0],
+                width = data[1],
+                height = data[2],
+                ledCount = data[3] shl 8 or data[4],
+                burst = data[5],
+                idleTimeout = data[6],
+                commands = data.subList(7, 11).fold(0L) { acc, b -> acc shl 8 or b.toLong() },
+                showTime = data[11] shl 8 or data[12],
+            )
+        }
+    }
+}
@@ -0,0 +1,361 @@
+package de.mk.ledmatrixbtapp.data
+
+import androidx.compose.ui.graphics.Color
+import kotlin.math.PI
+import kotlin.math.roundToInt
+import kotlin.math.sin
+
+/**
+ * An instruction of the shader programs run by the SHADER effect of the device.
+ *
+ * @property code The byte code of the instruction.
+ * @property pops The number of values popped from the stack.
+ * @property pushes The number of values pushed onto the stack.
+ * @property immediate True if the instruction is followed by a byte of code.
+ * @property cycles The estimate of the CPU cycles of the instruction the device checks its budget with.
+ */
+enum class ShaderOp(val code: Int, val pops: Int, val pushes: Int, val immediate: Boolean, val cycles: Int) {
+    PUSH(0x00, 0, 1, true, 20),
+    X(0x01, 0, 1, false, 16),
+    Y(0x02, 0, 1, false, 16),
+    T(0x03, 0, 1, false, 16),
+    I(0x04, 0, 1, false, 16),
+    ARG(0x05, 0, 1, true, 20),
+    DUP(0x06, 1, 2, false, 16),
+    SWAP(0x07, 2, 2, false, 18),
+    DROP(0x08, 1, 0, false, 12),
+    OVER(0x09, 2, 3, false, 16),
+    ADD(0x0A, 2, 1, false, 18),
+    SUB(0x0B, 2, 1, false, 18),
+    MUL(0x0C, 2, 1, false, 20),
+    SCALE(0x0D, 2, 1, false, 24),
+    AND(0x0E, 2, 1, false, 18),
+    OR(0x0F, 2, 1, false, 18),
+    XOR(0x10, 2, 1, false, 18),
+    MIN(0x11, 2, 1, false, 20),
+    MAX(0x12, 2, 1, false, 20),
+    LT(0x13, 2, 1, false, 20),
+    EQ(0x14, 2, 1, false, 20),
+    QADD(0x15, 2, 1, false, 22),
+    QSUB(0x16, 2, 1, false, 22),
+    SHL(0x17, 1, 1, true, 48),
+    SHR(0x18, 1, 1, true, 48),
+    NOT(0x19, 1, 1, false, 16),
+    SIN(0x1A, 1, 1, false, 22),
+    COS(0x1B, 1, 1, false, 22),
+    NOISE(0x1C, 2, 1, false, 420),
+    JZ(0x1D, 1, 0, true, 20),
+    JMP(0x1E, 0, 0, true, 16),
+    RGB(0x1F, 3, 0, false, 24),
+    HUE(0x20, 1, 0, false, 60),
+    PAL(0x21, 1, 0, false, 140),
+    ;
+
+    companion object {
+        fun of(code: Int) = values().getOrNull(code)
+    }
+}
+
+/**
+ * A shader program as written into the device by WRITE_SHADER.
+ *
+ * @property palette The colors looked up by PAL.
+ * @property code The byte code.
+ */
+class ShaderProgram(val palette: List<Color>, val code: ByteArray) {
+    /**
+     * The program as stored by the device: length (2), palette size, [r, g, b] * palette size, code.
+     */
+    fun toBytes(): ByteArray {
+        val length = 3 + palette.size * 3 + code.size
+        return byteArrayOf((length shr 8).toByte(), length.toByte(), palette.size.toByte()) +
+                palette.flatMap { color ->
+                    listOf(color.red, color.green, color.blue).map { (it * 255).roundToInt().toByte() }
+                }.toByteArray() + code
+    }
+
+    /**
+     * The CPU cycles a frame takes at most on a matrix, as every instruction runs at most once per pixel.
+     */
+    fun worstCaseCycles(ledCount: Int): Long {
+        var cycles = ShaderAssembler.PIXEL_CYCLES.toLong()
+        var pc = 0
+        while (pc < code.size) {
+            val op = ShaderOp.of(code[pc].toInt() and 0xFF) ?: break
+            cycles += op.cycles
+            pc += if (op.immediate) 2 else 1
+        }
+        return cycles * ledCount
+    }
+}
+
+/**
+ * Translates the text form of a shader program into byte code and checks it the same way the device does.
+ *
+ * One instruction per line, named like [ShaderOp]; everything after ';' is a comment.
+ * PUSH, ARG, SHL and SHR take a number, JZ and JMP take the name of a label defined by a line 'name:'.
+ * Jumps only go forward.
+ */
+object ShaderAssembler {
+    const val MAX_COLORS = 16
+    const val MAX_CODE = 64
+    const val STACK_SIZE = 8
+    const val CYCLE_BUDGET = 16_000_000L / 1000 * 8
+    const val PIXEL_CYCLES = 120
+
+    /**
+     * Assemble a program.
+     *
+     * @param source The text of the program.
+     * @param palette The colors looked up by PAL.
+     * @param ledCount The number of LEDs of the matrix, which the budget of the program depends on.
+     * @return The program.
+     * @throws IllegalArgumentException If the program is invalid, naming the line of the error.
+     */
+    fun assemble(source: String, palette: List<Color> = emptyList(), ledCount: Int = 64): ShaderProgram {
+        require(palette.size <= MAX_COLORS) { "At most $MAX_COLORS colors" }
+        val lines = source.lines()
+            .mapIndexed { i, line -> i + 1 to line.substringBefore(';').trim() }
+            .filter { it.second.isNotEmpty() }
+
+        // the first pass assigns the addresses of the labels
+        val labels = mutableMapOf<String, Int>()
+        var pc = 0
+        for ((number, line) in lines) {
+            if (line.endsWith(':')) {
+                labels[line.dropLast(1).trim().lowercase()] = pc
+                continue
+            }
+            val op = parseOp(number, line)
+            pc += if (op.immediate) 2 else 1
+        }
+
+        val code = mutableListOf<Byte>()
+        for ((number, line) in lines) {
+            if (line.endsWith(':')) continue
+            val op = parseOp(number, line)
+            val argument = line.split(Regex("\\s+")).getOrNull(1)
+            code += op.code.toByte()
+            if (!op.immediate) {
+                require(argument == null) { "Line $number: ${op.name} takes no argument" }
+                continue
+            }
+            requireNotNull(argument) { "Line $number: ${op.name} needs an argument" }
+            val value = when (op) {
+                ShaderOp.JZ, ShaderOp.JMP -> {
+                    val target = labels[argument.lowercase()]
+                        ?: throw IllegalArgumentException("Line $number: unknown label $argument")
+                    target - (code.size + 1)
+                }
+                else -> argument.toIntOrNull()
+                    ?: throw IllegalArgumentException("Line $number: $argument is not a number")
+            }
+            val range = when (op) {
+                ShaderOp.ARG -> 0..7
+                ShaderOp.SHL, ShaderOp.SHR -> 0..7
+                else -> 0..255
+            }
+            require(value in range) { "Line $number: ${op.name} $argument is out of range (jumps only go forward)" }
+            code += value.toByte()
+        }
+        require(code.size in 1..MAX_CODE) { "The code must have 1 to $MAX_CODE bytes" }
+
+        val program = ShaderProgram(palette, code.toByteArray())
+        checkCode(program.code, palette.isNotEmpty())
+        val cycles = program.worstCaseCycles(ledCount)
+        require(cycles <= CYCLE_BUDGET) { "The program takes up to $cycles cycles per frame, at most $CYCLE_BUDGET are allowed" }
+        return program
+    }
+
+    private fun parseOp(number: Int, line: String): ShaderOp {
+        val name = line.split(Regex("\\s+")).first().uppercase()
+        return ShaderOp.values().find { it.name == name }
+            ?: throw IllegalArgumentException("Line $number: unknown instruction $name")
+    }
+
+    /**
+     * Follow the depth of the stack through the code; it must be the same on every path leading to a jump target.
+     * PAL is only allowed with a palette, which is checked on the decoded instructions, as immediates may hold any byte.
+     */
+    private fun checkCode(code: ByteArray, hasPalette: Boolean) {
+        val depths = IntArray(code.size + 1) { -1 }
+        var depth = 0
+        var pc = 0
+        while (pc < code.size) {
+            if (depth < 0) depth = depths[pc]
+            else require(depths[pc] < 0 || depths[pc] == depth) { "The stack differs at byte $pc depending on the path" }
+            val op = ShaderOp.of(code[pc].toInt() and 0xFF)!!
+            val argument = if (op.immediate) code[pc + 1].toInt() and 0xFF else 0
+            require(op != ShaderOp.PAL || hasPalette) { "PAL at byte $pc needs a palette" }
+            pc += if (op.immediate) 2 else 1
+            if (depth >= 0) {
+                require(depth >= op.pops) { "${op.name} at byte ${pc - 1} pops from an empty stack" }
+                depth += op.pushes - op.pops
+                require(depth <= STACK_SIZE) { "The stack exceeds $STACK_SIZE values at byte ${pc - 1}" }
+            }
+            if (op == ShaderOp.JZ || op == ShaderOp.JMP) {
+                if (depth >= 0) depths[pc + argument] = depth
+                if (op == ShaderOp.JMP) depth = -1
+            }
+        }
+    }
+}
+
+/**
+ * Runs a shader program like the device does, to preview it and to count the CPU cycles it takes.
+ *
+ * @property program The program.
+ * @property width The width of the matrix.
+ * @property height The height of the matrix.
+ */
+class ShaderSimulator(private val program: ShaderProgram, val width: Int, val height: Int) {
+    /**
+     * A frame rendered by the program.
+     *
+     * @property colors The color of every LED, row by row from the top left.
+     * @property cycles The estimated CPU cycles the device takes for the frame.
+     */
+    data class Frame(val colors: List<Color>, val cycles: Long)
+
+    /**
+     * Render the frame for a time.
+     *
+     * @param t The time in milliseconds.
+     * @param params The parameters of the effect.
+     */
+    fun render(t: Long, params: IntArray = IntArray(8)): Frame {
+        var cycles = 0L
+        val colors = List(width * height) { i ->
+            val (color, pixelCycles) = run(i % width, i / width, ((t shr 4) and 0xFF).toInt(), i and 0xFF, params)
+            cycles += pixelCycles
+            color
+        }
+        return Frame(colors, cycles)
+    }
+
+    private fun run(x: Int, y: Int, t: Int, i: Int, params: IntArray): Pair<Color, Long> {
+        val code = program.code
+        val stack = ArrayDeque<Int>()
+        var out = Triple(0, 0, 0)
+        var cycles = ShaderAssembler.PIXEL_CYCLES.toLong()
+        var pc = 0
+        while (pc < code.size) {
+            val op = ShaderOp.of(code[pc].toInt() and 0xFF) ?: break
+            val imm = if (op.immediate) code[pc + 1].toInt() and 0xFF else 0
+            pc += if (op.immediate) 2 else 1
+            cycles += op.cycles
+            fun pop() = stack.removeLast()
+            fun push(v: Int) = stack.addLast(v and 0xFF)
+            when (op) {
+                ShaderOp.PUSH -> push(imm)
+                ShaderOp.X -> push(x)
+                ShaderOp.Y -> push(y)
+                ShaderOp.T -> push(t)
+                ShaderOp.I -> push(i)
+                ShaderOp.ARG -> push(params[imm])
+                ShaderOp.DUP -> stack.last().let(::push)
+                ShaderOp.SWAP -> pop().let { b -> pop().let { a -> push(b); push(a) } }
+                ShaderOp.DROP -> pop()
+                ShaderOp.OVER -> push(stack[stack.size - 2])
+                ShaderOp.NOT -> push(255 - pop())
+                ShaderOp.SHL -> push(pop() shl imm)
+                ShaderOp.SHR -> push(pop() shr imm)
+                ShaderOp.SIN -> push(sin8(pop()))
+                ShaderOp.COS -> push(sin8(pop() + 64))
+                ShaderOp.JZ -> if (pop() == 0) pc += imm
+                ShaderOp.JMP -> pc += imm
+                ShaderOp.RGB -> pop().let { b -> pop().let { g -> out = Triple(pop(), g, b) } }
+                ShaderOp.HUE -> out = wheel(pop())
+                ShaderOp.PAL -> out = palette(pop())
+                else -> {
+                    val b = pop()
+                    val a = pop()
+                    push(
+                        when (op) {
+                            ShaderOp.ADD -> a + b
+                            ShaderOp.SUB -> a - b
+                            ShaderOp.MUL -> a * b
+                            ShaderOp.SCALE -> a * (b + 1) shr 8
+                            ShaderOp.AND -> a and b
+                            ShaderOp.OR -> a or b
+                            ShaderOp.XOR -> a xor b
+                            ShaderOp.MIN -> minOf(a, b)
+                            ShaderOp.MAX -> maxOf(a, b)
+                            ShaderOp.LT -> if (a < b) 255 else 0
+                            ShaderOp.EQ -> if (a == b) 255 else 0
+                            ShaderOp.QADD -> minOf(a + b, 255)
+                            ShaderOp.QSUB -> maxOf(a - b, 0)
+                            ShaderOp.NOISE -> noise8(a shl 4, b shl 4)
+                            else -> 0
+                        }
+                    )
+                }
+            }
+        }
+        return Color(out.first, out.second, out.third) to cycles
+    }
+
+    private fun palette(v: Int): Triple<Int, Int, Int> {
+        val colors = program.palette.map { c -> listOf(c.red, c.green, c.blue).map { (it * 255).roundToInt() } }
+        val pos = v * colors.size
+        val a = colors[pos shr 8]
+        val b = colors[((pos shr 8) + 1) % colors.size]
+        val w = (pos and 0xFF).let { it + (it shr 7) }
+        return Triple(
+            (a[0] * (256 - w) + b[0] * w) shr 8,
+            (a[1] * (256 - w) + b[1] * w) shr 8,
+            (a[2] * (256 - w) + b[2] * w) shr 8
+        )
+    }
+
+    private companion object {
+        val SIN8 = IntArray(256) { (128 + 127 * sin(2 * PI * it / 256)).roundToInt() }
+
+        /** The permutation of Ken Perlin's noise, the same one the device hashes its lattice points with. */
+        val PERMUTATION = intArrayOf(
+            151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
+            140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 190, 6, 148,
+            247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32,
+            57, 177, 33, 88, 237, 149, 56, 87, 174, 20, 125, 136, 171, 168, 68, 175,
+            74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122,
+            60, 211, 133, 230, 220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54,
+            65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+            200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64,
+            52, 217, 226, 250, 124, 123, 5, 202, 38, 147, 118, 126, 255, 82, 85, 212,
+            207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213,
+            119, 248, 152, 2, 44, 154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9,
+            129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+            218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241,
+            81, 51, 145, 235, 249, 14, 239, 107, 49, 192, 214, 31, 181, 199, 106, 157,
+            184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93,
+            222, 114, 67, 29, 24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180,
+        )
+
+        fun sin8(x: Int) = SIN8[x and 0xFF]
+
+        fun lerp8(a: Int, b: Int, t: Int) = if (b >= a) a + ((b - a) * t shr 8) else a - ((a - b) * t shr 8)
+
+        fun ease8(t: Int): Int {
+            val t2 = t * t shr 8
+            return minOf(3 * t2 - (2 * t2 * t shr 8), 255)
+        }
+
+        fun hash(x: Int, y: Int) = PERMUTATION[(PERMUTATION[x and 0xFF] + y) and 0xFF]
+
+        fun noise8(x: Int, y: Int): Int {
+            val xi = x shr 8
+            val yi = y shr 8
+            val xf = ease8(x and 0xFF)
+            val yf = ease8(y and 0xFF)
+            val top = lerp8(hash(xi, yi), hash(xi + 1, yi), xf)
+            val bottom = lerp8(hash(xi, yi + 1), hash(xi + 1, yi + 1), xf)
+            return lerp8(top, bottom, yf)
+        }
+
+        fun wheel(hue: Int): Triple<Int, Int, Int> = when {
+            hue < 85 -> Triple(255 - hue * 3, hue * 3, 0)
+            hue < 170 -> (hue - 85).let { Triple(0, 255 - it * 3, it * 3) }
+            else -> (hue - 170).let { Triple(it * 3, 0, 255 - it * 3) }
+        }
+    }
+}
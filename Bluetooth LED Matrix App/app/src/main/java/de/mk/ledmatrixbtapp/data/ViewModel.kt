@@ -55,7 +55,59 @@ class ViewModel(private val app: Application) : AndroidViewModel(app) {
     val devices: StateFlow<Set<BluetoothDevice>> = _devices.asStateFlow()
 
     private val receiver = object : BroadcastReceiver() {
-        @SuppressLint("MissingPermission")
+        /**
+     * Draw the colors of some leds over the content of the device without changing it,
+     * so a running effect keeps running underneath.
+     */
+    fun sendOverlay(leds: Set<Int>, alpha: Float = 1f) {
+        viewModelScope.launch {
+            try {
+                withContext(Dispatchers.IO) {
+                    if (!_info.value.supports(Command.SET_OVERLAY.code)) {
+                        _lastError.value = "Overlays are not supported by the device"
+                        return@withContext
+                    }
+                    val opacity = alpha.times(255).toInt().coerceIn(1, 255).toByte()
+                    _leds.value
+                        .filter { it.id in leds }
+                        .chunked((_info.value.burst - 3) / 6)
+                        .forEach { chunk ->
+                            Command.SET_OVERLAY(OVERLAY_BLEND_ALPHA, chunk.size.toByte(), *chunk.flatMap { (id, color) ->
+                                listOf(
+                                    (id shr 8).toByte(),
+                                    id.toByte(),
+                                    color.red.times(255).toInt().toByte(),
+                                    color.green.times(255).toInt().toByte(),
+                                    color.blue.times(255).toInt().toByte(),
+                                    opacity
+                                )
+                            }.toByteArray()).write()
+                        }
+                }
+            } catch (e: Exception) {
+                e.printStackTrace()
+                _lastError.value = e.message
+            }
+        }
+    }
+
+    /**
+     * Remove everything drawn by [sendOverlay].
+     */
+    fun clearOverlay() {
+        viewModelScope.launch {
+            try {
+                withContext(Dispatchers.IO) {
+                    if (_info.value.supports(Command.CLEAR_OVERLAY.code)) Command.CLEAR_OVERLAY().write()
+                }
+            } catch (e: Exception) {
+                e.printStackTrace()
+                _lastError.value = e.message
+            }
+        }
+    }
+
+    @SuppressLint("MissingPermission")
         override fun onReceive(context: Context, intent: Intent) {
             if (BluetoothDevice.ACTION_BOND_STATE_CHANGED == intent.action) {
                 _devices.value = btAdapter.bondedDevices
@@ -66,9 +118,12 @@ class ViewModel(private val app: Application) : AndroidViewModel(app) {
     private val _btDevice: MutableStateFlow<BluetoothDevice?> = MutableStateFlow(null)
     val btDevice: StateFlow<BluetoothDevice?> = _btDevice.asStateFlow()
 
-    private val _leds = MutableStateFlow(Array(64) { LED(it, Color.Green) })
+    private val _leds = MutableStateFlow(Array(DeviceInfo.DEFAULT.ledCount) { LED(it, Color.Green) })
     val leds: StateFlow<Array<LED>> = _leds.asStateFlow()
 
+    private val _info = MutableStateFlow(DeviceInfo.DEFAULT)
+    val info: StateFlow<DeviceInfo> = _info.asStateFlow()
+
     private val uuid = UUID.fromString("00001101-0000-1000-8000-00805F9B34FB")
     private var socket: BluetoothSocket? = null
     private val outS get() = socket?.outputStream
@@ -106,7 +161,10 @@ class ViewModel(private val app: Application) : AndroidViewModel(app) {
                     socket = device.createRfcommSocketToServiceRecord(uuid).also { it.connect() }
                     resultListener = inS?.let { BluetoothResultListener(it) }
                     resultListener?.start()
-                    withContext(Dispatchers.IO) { readColors() }
+                    withContext(Dispatchers.IO) {
+                        readInfo()
+                        readColors()
+                    }
                 } catch (e: Exception) {
                     e.printStackTrace()
                 }
@@ -140,12 +198,18 @@ class ViewModel(private val app: Application) : AndroidViewModel(app) {
                 withContext(Dispatchers.IO) {
                     if (leds.size == _leds.value.size) {
                         _leds.value.first().color.let(::writeColorAll)
+                    } else if (_info.value.supports(Command.FILL_RANGE.code)) {
+                        // consecutive leds of the same color are sent as a single range
+                        _leds.value
+                            .filter { it.id in leds }
+                            .runs()
+                            .forEach(::fillRange)
                     } else {
-                        // the bluetooth module can only handle 16 leds at most
+                        // the receive buffer of the device limits the number of leds per command,
                         // so we need to split the leds into chunks
                         _leds.value
                             .filter { it.id in leds }
-                            .chunked(16)
+                            .chunked((_info.value.burst - 1) / 4)
                             .map(List<LED>::toSet)
                             .forEach(::writeColors)
                     }
@@ -157,6 +221,34 @@ class ViewModel(private val app: Application) : AndroidViewModel(app) {
         }
     }
 
+    /**
+     * Write a shader program into the device and run it.
+     * The device needs about 3.4 ms per byte to store the program, so it is sent in chunks,
+     * each one waiting for the response to the previous one.
+     */
+    fun sendShader(program: ShaderProgram) {
+        viewModelScope.launch {
+            try {
+                withContext(Dispatchers.IO) {
+                    if (!_info.value.supports(Command.WRITE_SHADER.code)) {
+                        _lastError.value = "Shaders are not supported by the device"
+                        return@withContext
+                    }
+                    program.toBytes().asList().chunked(SHADER_CHUNK_SIZE).forEachIndexed { i, chunk ->
+                        val offset = i * SHADER_CHUNK_SIZE
+                        Command.WRITE_SHADER(
+                            (offset shr 8).toByte(), offset.toByte(), chunk.size.toByte(), *chunk.toByteArray()
+                        ).write()
+                    }
+                    Command.EFFECT(SHADER_EFFECT, 0).write()
+                }
+            } catch (e: Exception) {
+                e.printStackTrace()
+                _lastError.value = e.message
+            }
+        }
+    }
+
     @SuppressLint("MissingPermission")
     fun refresh() {
         viewModelScope.launch {
@@ -169,7 +261,10 @@ class ViewModel(private val app: Application) : AndroidViewModel(app) {
                     resultListener = inS?.let { BluetoothResultListener(it) }
                     resultListener?.start()
                 }
-                withContext(Dispatchers.IO) { readColors() }
+                withContext(Dispatchers.IO) {
+                    readInfo()
+                    readColors()
+                }
             } catch (e: Exception) {
                 e.printStackTrace()
                 _lastError.value = e.message
@@ -179,35 +274,276 @@ class ViewModel(private val app: Application) : AndroidViewModel(app) {
 
 
     /*
-     * Bluetooth command structure:
+     * Bluetooth command structure (protocol version 2):
+     *
+     * Multi-byte values are sent big-endian (high byte first).
+     * Commands with a known length are executed and answered as soon as their last byte has been received.
+     * Commands of variable length (0x02) and erroneous commands are answered once no data has been received
+     * for BT_IDLE_TIMEOUT milliseconds.
+     * The protocol version only changes if existing commands change; added commands are discovered through 0x0D.
+     * While the device is turned off, it sleeps until data is received. The data received in the first 3 milliseconds
+     * after waking up is discarded, so send a single 0x00 and wait a few milliseconds before the first command.
+     * The device stays awake for 10 seconds after the last data, and while connected if the STATE line is wired.
      *
      * 0x01
      *      get the color of all leds
      *      1 byte: cmd
      *      respond: cmd, status, ([number, r, g, b] * count)
+     *      only the first 256 leds are reported, use 0x0B for larger matrices
      * 0x02
      *      set some specific leds to a specific color
      *      at most count * 4 + 1 bytes: cmd, [number, r, g, b] * count
      *      respond: cmd, status
+     *      number = logical number of the led, counted row by row from the top left of the matrix
+     *      only the first 256 leds can be addressed, use 0x09 - 0x0C for larger matrices
      * 0x03
      *      set all leds to a specific color
      *      4 bytes: cmd, r, g, b
      *      respond: cmd, status
+     * 0x04
+     *      render a gradient onto the whole matrix
+     *      at most 4 + stops * 4 bytes: cmd, type, a, b, stops, [position, r, g, b] * stops
+     *      type 0x00 (linear): a, b = signed x and y components of the direction vector
+     *      type 0x01 (radial): a, b = x and y coordinates of the center
+     *      2 to 8 stops, sorted by position (0 - 255)
+     *      respond: cmd, status
+     * 0x05
+     *      render a two-colored pattern onto the whole matrix
+     *      9 bytes: cmd, type, size, r1, g1, b1, r2, g2, b2
+     *      type 0x00: checker, 0x01: vertical stripes, 0x02: horizontal stripes, 0x03: rings
+     *      size = size of a pattern cell in pixels (> 0)
+     *      respond: cmd, status
+     * 0x06
+     *      shift the content of the matrix in place
+     *      7 bytes: cmd, dx, dy, wrap, r, g, b
+     *      dx, dy = signed number of columns to the right and rows down
+     *      wrap 0x00: fill the vacated pixels with r, g, b; 0x01: wrap around
+     *      respond: cmd, status
+     * 0x07
+     *      shift the content of the matrix by one column and insert a new column at the vacated edge
+     *      2 + height * 3 bytes: cmd, edge, [r, g, b] * height (top to bottom)
+     *      edge 0x00: insert at the right edge (content moves left), 0x01: insert at the left edge
+     *      respond: cmd, status
+     * 0x08
+     *      shift the content of the matrix by one row and insert a new row at the vacated edge
+     *      2 + width * 3 bytes: cmd, edge, [r, g, b] * width (left to right)
+     *      edge 0x00: insert at the bottom edge (content moves up), 0x01: insert at the top edge
+     *      respond: cmd, status
+     * 0x09
+     *      set a range of consecutive leds to individual colors
+     *      5 + count * 3 bytes: cmd, start (2), count (2), [r, g, b] * count
+     *      respond: cmd, status
+     * 0x0A
+     *      set a range of consecutive leds to a single color
+     *      8 bytes: cmd, start (2), count (2), r, g, b
+     *      respond: cmd, status
+     * 0x0B
+     *      get the colors of a range of consecutive leds
+     *      5 bytes: cmd, start (2), count (2)
+     *      respond: cmd, status, (start (2), count (2), [r, g, b] * count)
+     * 0x0C
+     *      set some specific leds to a specific color, with 16 bit led numbers
+     *      3 + count * 5 bytes: cmd, count (2), [number (2), r, g, b] * count
+     *      respond: cmd, status
+     * 0x0D
+     *      get the capabilities of the device
+     *      1 byte: cmd
+     *      respond: cmd, status, version, width, height, leds (2), burst, idle timeout, commands (4), show time (2)
+     *      burst = number of bytes that may be sent without waiting for a response (receive buffer of the device)
+     *      idle timeout = BT_IDLE_TIMEOUT in milliseconds
+     *      commands = bit n is set if command n is supported
+     *      show time = time in microseconds it takes to send a frame to the leds, no data can be received meanwhile
+     * 0x0E
+     *      run an effect on the device until another command changes the leds
+     *      3 + count bytes: cmd, effect, count, [param] * count
+     *      at most 8 params, missing params and params that are 0 select the default of the effect
+     *      effect 0x00: random colors, no params
+     *      effect 0x01: plasma, params: speed, scale
+     *      effect 0x02: fire, params: cooling, sparking
+     *      effect 0x03: rain, params: r, g, b, density, trail
+     *      effect 0x04: rainbow, params: speed, scale, direction (0x00 horizontal, 0x01 vertical, 0x02 diagonal)
+     *      effect 0x05: breathing, params: r, g, b, period (in 100 ms)
+     *      effect 0x06: life, params: birth, survival, r, g, b, flags, generation time (in 10 ms), seed
+     *          birth, survival = bit n - 1 set if a cell is born / survives with n neighbors (default 0x04, 0x06: B3/S23)
+     *          flags bit 0: bounded edges, bit 1: seed from the current leds (not black = alive),
+     *          bit 2: survival 0x00 means no survival instead of the default
+     *          seed = seed of the random start population, 0x00 = random
+     *      effect 0x07: text set by 0x0F, params: r, g, b, step time (in 10 ms)
+     *      effect 0x08: keyframe animation written by 0x10, params: flags
+     *          flags bit 0: loop, fading from the last keyframe back to the first one (default: stop at the last one)
+     *          selecting the effect starts the animation at its first keyframe; the leds stay black if there is none
+     *      effect 0x09: shader program written by 0x11, params: read by the program (ARG)
+     *          the leds stay black if there is no valid program
+     *      effect 0x0A: particles, params: style, r, g, b, rate, trail
+     *          style 0x00: sparks, 0x01: confetti, 0x02: meteors; r, g, b = 0 selects the colors of the style
+     *          rate = chance per frame out of 256 that particles are spawned, trail = brightness kept per frame
+     *      respond: cmd, status
+     * 0x0F
+     *      scroll a text through the matrix
+     *      6 + length bytes: cmd, r, g, b, step time, length, [char] * length
+     *      step time = time in 10 ms the text takes to move by one column (0x00 = default)
+     *      at most 32 printable ASCII characters, others are shown as '?'
+     *      respond: cmd, status
+     * 0x10
+     *      write a chunk of the keyframe animation played by effect 0x08 into the EEPROM
+     *      4 + count bytes: cmd, offset (2), count, [byte] * count
+     *      at most 32 bytes per chunk; wait for the response before sending the next chunk (about 3.4 ms per byte)
+     *      the animation is validated once the chunk reaching its length has been written (invalid argument if it fails)
+     *      animation: length (2), palette size, keyframes, [r, g, b] * palette size, [keyframe] * keyframes
+     *          length = number of bytes of the whole animation (at most 256), 1 to 16 colors, at least 1 keyframe
+     *      keyframe: fade time (2), type, data
+     *          fade time = time in milliseconds the fade from the previous keyframe takes
+     *          type 0x00 (full): [index << 4 | index] * ((leds + 1) / 2), palette index of every led, even led first
+     *          type 0x01 (sparse): count, [number (2), index] * count, palette index of the leds that change
+     *          the first keyframe starts from all leds having palette index 0
+     *      respond: cmd, status
+     * 0x11
+     *      write a chunk of the shader program run by effect 0x09 into the EEPROM
+     *      4 + count bytes: cmd, offset (2), count, [byte] * count
+     *      chunks and validation as for 0x10
+     *      program: length (2), palette size, [r, g, b] * palette size, [code] * (length - 3 - palette size * 3)
+     *          length = number of bytes of the whole program (at most 128), 0 to 16 colors, 1 to 64 bytes of code
+     *      the code runs once per pixel on a stack of up to 8 bytes, arithmetic wraps around unless stated otherwise:
+     *          0x00 PUSH n, 0x01 X, 0x02 Y, 0x03 T (time in 16 ms), 0x04 I (led number), 0x05 ARG n (effect param n),
+     *          0x06 DUP, 0x07 SWAP, 0x08 DROP, 0x09 OVER,
+     *          0x0A ADD, 0x0B SUB, 0x0C MUL, 0x0D SCALE (a * b / 256), 0x0E AND, 0x0F OR, 0x10 XOR,
+     *          0x11 MIN, 0x12 MAX, 0x13 LT, 0x14 EQ (255 if true, 0 otherwise), 0x15 QADD, 0x16 QSUB (saturating),
+     *          0x17 SHL n, 0x18 SHR n, 0x19 NOT (255 - a), 0x1A SIN, 0x1B COS, 0x1C NOISE (x, y, 16 per cell),
+     *          0x1D JZ n (pop, skip n bytes if 0), 0x1E JMP n (skip n bytes),
+     *          0x1F RGB (pop r, g, b), 0x20 HUE (pop color wheel position), 0x21 PAL (pop palette position)
+     *      the color of a pixel is the last one output (black if none); jumps only go forward
+     *      programs whose worst case exceeds 8 ms per frame are invalid
+     *      respond: cmd, status
+     * 0x12
+     *      draw some specific leds over the content of the matrix, which itself stays unchanged
+     *      3 + count * 6 bytes: cmd, blend, count, [number (2), r, g, b, alpha] * count
+     *      blend 0x00 (alpha): the led fades from its color to r, g, b by alpha
+     *      blend 0x01 (multiply): the led fades from its color to its color multiplied by r, g, b (a mask) by alpha
+     *      alpha = opacity (0xFF = opaque), 0x00 removes the led from the overlay
+     *      the blend mode applies to the whole overlay, which keeps up to 16 leds across commands
+     *      the overlay stays over effects and over leds set by other commands; status 0xFE if it is full
+     *      respond: cmd, status
+     * 0x13
+     *      remove all leds from the overlay
+     *      1 byte: cmd
+     *      respond: cmd, status
+     * 0x14
+     *      set the time of the crossfade shown when the mode or the effect changes, and when the device turns off
+     *      3 bytes: cmd, time (2)
+     *      time = time in milliseconds (default 400), 0x0000 switches instantly
+     *      respond: cmd, status
+     * 0x15
+     *      limit the current drawn by the leds by scaling down the brightness of frames that would exceed it
+     *      3 bytes: cmd, limit (2)
+     *      limit = current in milliamps (default 1000), 0x0000 = no limit
+     *      the current is estimated with 20 mA per channel at full brightness and 1 mA per led
+     *      the colors reported by 0x01 and 0x0B are not affected
+     *      respond: cmd, status
+     * 0x16
+     *      set the brightness of the leds
+     *      2 bytes: cmd, brightness
+     *      brightness = 0x00 (off) to 0xFF (full, default)
+     *      the colors reported by 0x01 and 0x0B are not affected; effects and crossfades dither the levels in between
+     *      respond: cmd, status
+     * 0x17
+     *      get the runtime accounting of the tasks of the firmware since the last request, and reset it
+     *      1 byte: cmd
+     *      respond: cmd, status, frames (2), count, [runs (2), late (2), max (2), time (4)] * count, idle (4), wake (2),
+     *          pixel (2), command (2)
+     *      frames = number of frames shown, count = number of tasks (0: button, 1: bluetooth, 2: frame, 3: persistence)
+     *      runs = number of runs, late = number of runs that started after their deadline,
+     *      max, time = longest and total time of the runs in microseconds (the wire time of frames is mostly missed)
+     *      idle = time asleep in microseconds while no task was due, wake = longest latency from a tick to the
+     *          firmware running again in microseconds
+     *      pixel, command = time from the boot to the first frame shown and to the first command executed in milliseconds,
+     *          not reset (the first frame is shown before the Bluetooth module is ready)
+     * 0x18
+     *      store the colors of the leds as scene into a slot
+     *      2 bytes: cmd, slot
+     *      slot = 0x00 to 0x02 (EEPROM, kept when powered off; 0x00 only for the chained matrices) or
+     *          0x80 to 0x81 (SRAM, lost on reset; 0x80 only for the chained matrices)
+     *      the leds must show at most 16 different colors, else the status is 0xFE
+     *      a slot in the EEPROM takes up to 400 ms to be written, the response is sent once it has been written
+     *      respond: cmd, status
+     * 0x19
+     *      recall the scene of a slot, setting the colors of the leds to it and crossfading to it
+     *      4 bytes: cmd, slot, fade time (2)
+     *      fade time = time in milliseconds the crossfade takes, 0 to show the scene at once
+     *      the status is 0xFE if the slot is empty
+     *      respond: cmd, status
+     * 0x1A
+     *      move the wall clock of the device, which times COMMIT_AT
+     *      5 bytes: cmd, adjust (4)
+     *      adjust = signed time in milliseconds the clock is moved forward, 0 to read it only
+     *      respond: cmd, status, clock (4)
+     *      clock = time of the wall clock in milliseconds after the adjustment, wrapping around
+     *      to synchronize: send adjust 0 at host time t0, receive clock at t1, then send adjust = (t0 + t1) / 2 - clock
+     *          (in the time of the host); repeat to verify; the clock must be synchronized again after power-down
+     * 0x1B
+     *      stage the following frames: nothing is shown until they are committed, the leds can be changed by any commands
+     *      1 byte: cmd
+     *      frames not committed within 10 s are shown anyway
+     *      respond: cmd, status
+     * 0x1C
+     *      commit the staged frames, showing the colors of the leds once the wall clock reaches the given time
+     *      5 bytes: cmd, time (4)
+     *      time = time of the wall clock in milliseconds, at most 10 s ahead; a time passed already shows them at once
+     *      the status is 0xFE if no frames are staged
+     *      no command should be sent until the commit, as the frames are not shown while a command is being received
+     *      respond: cmd, status
+     * 0x1D
+     *      get a tunable parameter of the firmware
+     *      2 bytes: cmd, id
+     *      id = 0x00 frame delay of RANDOM (ms), 0x01 fade step of RANDOM, 0x02 range of the dim components of random
+     *          colors, 0x03 debounce time (ms), 0x04 long press time (ms), 0x05 double click time (ms),
+     *          0x06 repeat time (ms, 0 = none); the status is 0x03 for an unknown id, so the parameters can be listed
+     *      respond: cmd, status, type, value (2), min (2), max (2), default (2)
+     *      type = 0x00 (8 bit) or 0x01 (16 bit)
+     * 0x1E
+     *      set a tunable parameter of the firmware, it is persisted with the state
+     *      4 bytes: cmd, id, value (2)
+     *      the status is 0x03 for an unknown id or a value out of the range reported by 0x1D
+     *      respond: cmd, status
      *
      * respond codes:
      *      0x00: success
      *      0x01: invalid data length
      *      0x02: led number out of range
+     *      0x03: invalid argument
      *      0xFE: invalid state
      *      0xFF: invalid command
      */
 
     private val Byte.ok get() = toInt() == 0x00
 
-    private enum class Command(private val code: Byte) {
+    private companion object {
+        /** The maximum number of bytes the device writes into its EEPROM per command. */
+        const val SHADER_CHUNK_SIZE = 32
+
+        /** The ID of the effect running the shader program. */
+        const val SHADER_EFFECT: Byte = 0x09
+
+        /** The blend mode of the overlay drawing its colors over the content of the device. */
+        const val OVERLAY_BLEND_ALPHA: Byte = 0x00
+
+        /**
+         * The time in milliseconds to wait after waking the device up, longer than the time the device
+         * discards data after waking up, and than an awake device takes to answer the wake-up byte.
+         */
+        const val WAKE_TIME = 100L
+    }
+
+    private enum class Command(val code: Byte) {
         READ(0x01),
         WRITE(0x02),
         WRITE_ALL(0x03),
+        FILL_RANGE(0x0A),
+        READ_RANGE(0x0B),
+        INFO(0x0D),
+        EFFECT(0x0E),
+        WRITE_SHADER(0x11),
+        SET_OVERLAY(0x12),
+        CLEAR_OVERLAY(0x13),
         ;
 
         operator fun invoke(vararg data: Byte) = byteArrayOf(code, *data)
@@ -217,9 +553,38 @@ class ViewModel(private val app: Application) : AndroidViewModel(app) {
         }
     }
 
+    /**
+     * Wake the device up in case it is turned off and sleeping, as it discards the data received right after waking up.
+     * An awake device answers the single byte with an invalid command status, which is dropped by the next command.
+     */
     @Throws(IOException::class)
     @Blocking
-    private fun readColors() = Command.READ().write()
+    private fun wake() {
+        outS?.write(0)
+        outS?.flush()
+        Thread.sleep(WAKE_TIME)
+    }
+
+    /**
+     * Read the capabilities of the device.
+     * Devices that do not support GET_INFO are assumed to have the default capabilities.
+     */
+    @Throws(IOException::class)
+    @Blocking
+    private fun readInfo() {
+        wake()
+        _info.value = DeviceInfo.DEFAULT
+        Command.INFO().write(optional = true)
+    }
+
+    @Throws(IOException::class)
+    @Blocking
+    private fun readColors() = if (_info.value.supports(Command.READ_RANGE.code)) {
+        val count = _info.value.ledCount
+        Command.READ_RANGE(0, 0, (count shr 8).toByte(), count.toByte()).write()
+    } else {
+        Command.READ().write()
+    }
 
     @Throws(IOException::class)
     @Blocking
@@ -232,6 +597,30 @@ class ViewModel(private val app: Application) : AndroidViewModel(app) {
         )
     }.toByteArray()).write()
 
+    @Throws(IOException::class)
+    @Blocking
+    private fun fillRange(leds: List<LED>) = leds.first().let { (id, color) ->
+        Command.FILL_RANGE(
+            (id shr 8).toByte(),
+            id.toByte(),
+            (leds.size shr 8).toByte(),
+            leds.size.toByte(),
+            color.red.times(255).toInt().toByte(),
+            color.green.times(255).toInt().toByte(),
+            color.blue.times(255).toInt().toByte()
+        ).write()
+    }
+
+    /**
+     * Split a list of leds sorted by their id into runs of consecutive leds of the same color.
+     */
+    private fun List<LED>.runs(): List<List<LED>> = fold(mutableListOf<MutableList<LED>>()) { runs, led ->
+        val run = runs.lastOrNull()
+        if (run != null && run.last().id + 1 == led.id && run.last().color == led.color) run += led
+        else runs += mutableListOf(led)
+        runs
+    }
+
     @Throws(IOException::class)
     @Blocking
     private fun writeColorAll(color: Color) = Command.WRITE_ALL(
@@ -242,26 +631,29 @@ class ViewModel(private val app: Application) : AndroidViewModel(app) {
 
     @Throws(IOException::class)
     @Blocking
-    private fun ByteArray.write() {
+    private fun ByteArray.write(optional: Boolean = false) {
         resultListener?.reset()
         outS?.write(this)
         outS?.flush()
         runBlocking {
             withTimeoutOrNull(500) {
                 // wait for the response
-                resultListener?.data?.filter { it.isNotEmpty() }?.first()?.parseResult()
+                resultListener?.data?.filter { it.isNotEmpty() }?.first()?.parseResult(optional)
                 Unit
             } ?: _lastError.also { it.value = "Timeout" }
         }
     }
 
-    private fun ByteArray.parseResult() {
+    private fun ByteArray.parseResult(optional: Boolean) {
         println("RECEIVED: ${joinToString { "%02X".format(it) }}")
         val status = this[1]
+        // commands that are not supported by older devices are answered with an invalid command status
+        if (optional && status == 0xFF.toByte()) return
         if (!status.ok) {
             _lastError.value = when (status) {
                 0x01.toByte() -> "Invalid data length"
                 0x02.toByte() -> "LED number out of range"
+                0x03.toByte() -> "Invalid argument"
                 0xFE.toByte() -> "Invalid state"
                 0xFF.toByte() -> "Invalid command"
                 else -> "Unknown error"
@@ -277,7 +669,23 @@ class ViewModel(private val app: Application) : AndroidViewModel(app) {
                 .toTypedArray()
                 .also { _leds.value = it }
 
-            Command.WRITE, Command.WRITE_ALL -> Unit
+            Command.READ_RANGE -> this
+                .drop(6)
+                .map { it.toInt() and 0xFF }
+                .chunked(3)
+                .mapIndexed { i, it -> LED(i, Color(it[0], it[1], it[2])) }
+                .toTypedArray()
+                .also { _leds.value = it }
+
+            Command.INFO -> DeviceInfo.parse(drop(2).map { it.toInt() and 0xFF })?.let { info ->
+                _info.value = info
+                if (_leds.value.size != info.ledCount) {
+                    _leds.value = Array(info.ledCount) { LED(it, Color.Green) }
+                }
+            }
+
+            Command.WRITE, Command.WRITE_ALL, Command.FILL_RANGE, Command.EFFECT, Command.WRITE_SHADER,
+            Command.SET_OVERLAY, Command.CLEAR_OVERLAY -> Unit
             else -> _lastError.value = "Invalid command"
         }
     }
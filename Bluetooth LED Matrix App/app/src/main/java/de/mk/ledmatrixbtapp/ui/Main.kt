@@ -55,6 +55,7 @@ fun Main(vm: ViewModel = viewModel()) {
 
     val error by vm.lastError.collectAsState()
     val leds by vm.leds.collectAsState()
+    val info by vm.info.collectAsState()
     var selectedLeds by remember { mutableStateOf(emptySet<Int>()) }
     val color = leds.find { it.id in selectedLeds }?.color ?: Color.Black
     val snackbarHost = remember { SnackbarHostState() }
@@ -91,7 +92,7 @@ fun Main(vm: ViewModel = viewModel()) {
     ) { padding ->
         Column(Modifier.padding(padding)) {
             LazyVerticalGrid(
-                columns = GridCells.Fixed(8),
+                columns = GridCells.Fixed(info.width),
                 userScrollEnabled = false,
                 modifier = Modifier.padding(6.dp)
             ) {
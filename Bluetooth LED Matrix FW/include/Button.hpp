@@ -2,6 +2,7 @@
 #define BUTTON_HPP
 
 #include <Arduino.h>
+#include "SpscRing.hpp"
 
 
 /**
@@ -9,36 +10,108 @@
  * @brief A class that represents a button on an Arduino board.
  *
  * This class provides an interface for interacting with a button on an Arduino board.
- * It provides methods for attaching and detaching interrupts, reading the state of the button, and initializing the button.
+ * It provides methods for attaching and detaching interrupts, receiving the events of the button, and initializing the button.
+ *
+ * All buttons that have been initialized are sampled by sample(), which is called every millisecond from a timer
+ * interrupt. Every button debounces on its own: a change of the level is accepted once it has been stable for the
+ * debounce time, so an event is raised at most the debounce time after the contacts have settled.
+ * The events of all buttons are pushed into one lock-free ring and are received by the main loop with nextEvent().
  */
 class Button {
+public:
+    /**
+     * @enum event_kind_t
+     * @brief The events of a button.
+     */
+    enum class event_kind_t : uint8_t {
+        PRESS, ///< The button has been pressed.
+        RELEASE, ///< The button has been released.
+        LONG, ///< The button has been held for the long press time.
+        DOUBLE, ///< The button has been pressed within the double click time after it has been released, after PRESS.
+        REPEAT, ///< The button is still held, every repeat time after LONG.
+    };
+
+    /**
+     * @struct event_t
+     * @brief An event of a button.
+     */
+    struct event_t {
+        uint8_t button; ///< The number of the button, counted in the order the buttons have been initialized.
+        event_kind_t kind; ///< The event.
+    };
+
+    static constexpr uint8_t DEBOUNCE_TIME = 15; ///< The default debounce time in milliseconds.
+    static constexpr uint16_t LONG_PRESS_TIME = 500; ///< The default long press time in milliseconds.
+    static constexpr uint16_t DOUBLE_CLICK_TIME = 300; ///< The default double click time in milliseconds.
+    static constexpr uint16_t REPEAT_TIME = 200; ///< The default repeat time in milliseconds.
+    static constexpr uint8_t EVENT_QUEUE_SIZE = 16; ///< The number of events that can be queued, a power of two.
+
 private:
     uint8_t pin; ///< The pin number on the Arduino board where the button is connected.
+    uint8_t debounceTime; ///< The time the level must be stable to be accepted in milliseconds.
+    uint16_t longPressTime; ///< The time the button is held until LONG is raised in milliseconds.
+    uint16_t doubleClickTime; ///< The time after a release in which a press raises DOUBLE in milliseconds.
+    uint16_t repeatTime; ///< The time between two REPEAT events in milliseconds, 0 for none.
+
+    volatile uint8_t *input = nullptr; ///< The input register of the port of the pin.
+    uint8_t mask = 0; ///< The bit of the pin in the input register.
+    uint8_t number = 0; ///< The number of the button reported with its events.
+    bool pressed = false; ///< The debounced state of the button.
+    bool doubled = false; ///< True if the current press has raised DOUBLE.
+    uint8_t bounce = 0; ///< The time the level has differed from the debounced state in milliseconds.
+    uint16_t held = 0; ///< The time the button has been held in milliseconds, up to the long press time.
+    uint16_t repeat = 0; ///< The time until the next REPEAT event in milliseconds.
+    uint16_t released = UINT16_MAX; ///< The time since the last release in milliseconds, saturating.
+    Button *next = nullptr; ///< The next button sampled by sample().
+
+    static Button *first; ///< The first button sampled by sample().
+    static uint8_t count; ///< The number of buttons that have been initialized.
+    static SpscRing<event_t, EVENT_QUEUE_SIZE> events; ///< The events of all buttons.
 
-public:
     /**
-     * @enum state_t
-     * @brief An enumeration of the possible states of the button.
+     * @brief Sample the pin, debounce it and raise the events of the button.
      */
-    enum class state_t {
-        RELEASED, ///< The button is not being pressed.
-        PRESSED, ///< The button is being pressed.
-        PRESSED_CONTINUOUSLY ///< The button is being pressed continuously.
-    };
+    void update();
 
+    /**
+     * @brief Queue an event of the button. It is dropped if the queue is full.
+     *
+     * @param kind The event.
+     */
+    void raise(event_kind_t kind) { events.push({number, kind}); }
+
+public:
     /**
      * @brief Construct a new Button object.
      *
      * @param pin The pin number on the Arduino board where the button is connected.
+     * @param debounceTime The time the level must be stable to be accepted in milliseconds.
+     * @param longPressTime The time the button is held until LONG is raised in milliseconds.
+     * @param doubleClickTime The time after a release in which a press raises DOUBLE in milliseconds.
+     * @param repeatTime The time between two REPEAT events in milliseconds, 0 for none.
      */
-    explicit Button(uint8_t pin) : pin(pin) {}
+    explicit Button(uint8_t pin, uint8_t debounceTime = DEBOUNCE_TIME, uint16_t longPressTime = LONG_PRESS_TIME,
+                    uint16_t doubleClickTime = DOUBLE_CLICK_TIME, uint16_t repeatTime = REPEAT_TIME)
+            : pin(pin), debounceTime(debounceTime), longPressTime(longPressTime), doubleClickTime(doubleClickTime),
+              repeatTime(repeatTime) {}
 
     /**
      * @brief Initialize the button.
      *
-     * This method sets the pin mode to INPUT_PULLUP.
+     * This method sets the pin mode to INPUT_PULLUP and adds the button to the buttons sampled by sample().
+     * It must be called once per button, before the timer calling sample() is started.
+     */
+    void begin();
+
+    /**
+     * @brief Change the timing of the button. It applies from the next sample on.
+     *
+     * @param debounceTime The time the level must be stable to be accepted in milliseconds.
+     * @param longPressTime The time the button is held until LONG is raised in milliseconds.
+     * @param doubleClickTime The time after a release in which a press raises DOUBLE in milliseconds.
+     * @param repeatTime The time between two REPEAT events in milliseconds, 0 for none.
      */
-    void begin() const { pinMode(pin, INPUT_PULLUP); }
+    void setTiming(uint8_t debounceTime, uint16_t longPressTime, uint16_t doubleClickTime, uint16_t repeatTime);
 
     /**
      * @brief Attach an interrupt to the button.
@@ -59,13 +132,17 @@ public:
     void detachInterrupt() const { ::detachInterrupt(digitalPinToInterrupt(pin)); }
 
     /**
-     * @brief Read the state of the button.
-     *
-     * This method returns the current state of the button (RELEASED, PRESSED, or PRESSED_CONTINUOUSLY).
+     * @brief Sample all buttons. Must be called every millisecond, from a timer interrupt.
+     */
+    static void sample();
+
+    /**
+     * @brief Receive the oldest event of all buttons. Must only be called from the main loop.
      *
-     * @return The current state of the button.
+     * @param event Set to the event.
+     * @return False if there is no event, true otherwise.
      */
-    state_t read() const;
+    static bool nextEvent(event_t &event) { return events.pop(event); }
 };
 
 
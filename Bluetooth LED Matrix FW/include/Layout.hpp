@@ -0,0 +1,156 @@
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#include <Arduino.h>
+
+
+/**
+ * @enum rotation_t
+ * @brief The clockwise rotation the LED panel is mounted with.
+ */
+enum class rotation_t : uint8_t {
+    R0, ///< The panel is mounted upright.
+    R90, ///< The panel is rotated by 90 degrees.
+    R180, ///< The panel is rotated by 180 degrees.
+    R270, ///< The panel is rotated by 270 degrees.
+};
+
+/**
+ * @class Layout
+ * @brief A compile-time mapping from logical matrix coordinates to the index of the LED on the strip.
+ *
+ * The logical matrix is W pixels wide and H pixels high with its origin in the top left corner.
+ * The LEDs of the physical panel are wired row by row, either all rows in the same direction (progressive)
+ * or every second row in the opposite direction (serpentine). The panel may be mounted rotated.
+ * As all parameters are template arguments, the mapping is a constexpr expression that the compiler folds
+ * into a few additions and shifts without any branches on the layout configuration.
+ *
+ * @tparam W The logical width of the matrix.
+ * @tparam H The logical height of the matrix.
+ * @tparam SERPENTINE True if every second row of the panel is wired in the opposite direction.
+ * @tparam ROTATION The clockwise rotation the panel is mounted with.
+ */
+template<uint8_t W, uint8_t H, bool SERPENTINE = false, rotation_t ROTATION = rotation_t::R0>
+class Layout {
+    static_assert(W > 0 && H > 0, "the matrix must not be empty");
+
+public:
+    static constexpr uint8_t WIDTH = W; ///< The logical width of the matrix.
+    static constexpr uint8_t HEIGHT = H; ///< The logical height of the matrix.
+    static constexpr uint16_t COUNT = (uint16_t) W * H; ///< The number of LEDs of the matrix.
+
+    /// True if every logical row is a contiguous run of LEDs on the strip, so it can be moved with memmove.
+    static constexpr bool ROWS_CONTIGUOUS = ROTATION == rotation_t::R0 || ROTATION == rotation_t::R180;
+
+    /**
+     * @brief Map logical coordinates to the index of the LED on the strip.
+     *
+     * @param x The column, counted from the left.
+     * @param y The row, counted from the top.
+     * @return The index of the LED on the strip.
+     */
+    static constexpr uint16_t xy(uint8_t x, uint8_t y) { return wire(panelX(x, y), panelY(x, y)); }
+
+    /**
+     * @brief Map a logical LED number (counted row by row from the top left) to the index of the LED on the strip.
+     *
+     * @param n The logical LED number.
+     * @return The index of the LED on the strip.
+     */
+    static constexpr uint16_t index(uint16_t n) { return xy(n % W, n / W); }
+
+    /**
+     * @brief Get the index of the LED on the strip where a logical row starts if the rows are contiguous.
+     *
+     * @param y The row, counted from the top.
+     * @return The index of the LED on the strip of the lowest index of the row.
+     */
+    static constexpr uint16_t rowStart(uint8_t y) { return (uint16_t) panelY(0, y) * PANEL_WIDTH; }
+
+    /**
+     * @brief Check whether a logical row runs from right to left on the strip if the rows are contiguous.
+     *
+     * @param y The row, counted from the top.
+     * @return True if the LED index decreases with increasing x.
+     */
+    static constexpr bool rowReversed(uint8_t y) {
+        return (ROTATION == rotation_t::R180) != (SERPENTINE && (panelY(0, y) & 1));
+    }
+
+    /**
+     * @brief Check whether logical rows appear in reverse order on the strip if the rows are contiguous.
+     *
+     * @return True if the LED index decreases with increasing y.
+     */
+    static constexpr bool rowsReversed() { return ROTATION == rotation_t::R180; }
+
+private:
+    static constexpr bool SWAPPED = ROTATION == rotation_t::R90 || ROTATION == rotation_t::R270;
+    static constexpr uint8_t PANEL_WIDTH = SWAPPED ? H : W; ///< The number of LEDs per wired row of the panel.
+
+    static constexpr uint8_t panelX(uint8_t x, uint8_t y) {
+        return ROTATION == rotation_t::R0 ? x :
+               ROTATION == rotation_t::R90 ? H - 1 - y :
+               ROTATION == rotation_t::R180 ? W - 1 - x : y;
+    }
+
+    static constexpr uint8_t panelY(uint8_t x, uint8_t y) {
+        return ROTATION == rotation_t::R0 ? y :
+               ROTATION == rotation_t::R90 ? x :
+               ROTATION == rotation_t::R180 ? H - 1 - y : W - 1 - x;
+    }
+
+    static constexpr uint16_t wire(uint8_t px, uint8_t py) {
+        // serpentine rows are mirrored arithmetically instead of with a branch
+        return (uint16_t) py * PANEL_WIDTH + (SERPENTINE ? px + (py & 1) * (PANEL_WIDTH - 1 - 2 * px) : px);
+    }
+};
+
+/**
+ * @class TiledLayout
+ * @brief A compile-time mapping for several identical panels chained into one LED strip.
+ *
+ * The panels are arranged in a grid of TILES_X by TILES_Y panels and chained row by row, starting at the top left panel.
+ * It provides the same interface as Layout, so it can be used wherever a layout is expected.
+ *
+ * @tparam PANEL The layout of a single panel.
+ * @tparam TILES_X The number of panels next to each other.
+ * @tparam TILES_Y The number of panels on top of each other.
+ */
+template<class PANEL, uint8_t TILES_X, uint8_t TILES_Y = 1>
+class TiledLayout {
+    static_assert(TILES_X > 0 && TILES_Y > 0, "there must be at least one panel");
+
+public:
+    static constexpr uint8_t WIDTH = PANEL::WIDTH * TILES_X; ///< The logical width of the matrix.
+    static constexpr uint8_t HEIGHT = PANEL::HEIGHT * TILES_Y; ///< The logical height of the matrix.
+    static constexpr uint16_t COUNT = PANEL::COUNT * TILES_X * TILES_Y; ///< The number of LEDs of the matrix.
+
+    /// Logical rows are only contiguous if the panels are stacked on top of each other.
+    static constexpr bool ROWS_CONTIGUOUS = PANEL::ROWS_CONTIGUOUS && TILES_X == 1 && !PANEL::rowsReversed();
+
+    static_assert((uint16_t) PANEL::WIDTH * TILES_X < 256 && (uint16_t) PANEL::HEIGHT * TILES_Y < 256,
+                  "the matrix must not exceed 255 pixels in either direction");
+
+    /// @copydoc Layout::xy
+    static constexpr uint16_t xy(uint8_t x, uint8_t y) {
+        return ((y / PANEL::HEIGHT) * TILES_X + x / PANEL::WIDTH) * PANEL::COUNT +
+               PANEL::xy(x % PANEL::WIDTH, y % PANEL::HEIGHT);
+    }
+
+    /// @copydoc Layout::index
+    static constexpr uint16_t index(uint16_t n) { return xy(n % WIDTH, n / WIDTH); }
+
+    /// @copydoc Layout::rowStart
+    static constexpr uint16_t rowStart(uint8_t y) {
+        return (y / PANEL::HEIGHT) * PANEL::COUNT + PANEL::rowStart(y % PANEL::HEIGHT);
+    }
+
+    /// @copydoc Layout::rowReversed
+    static constexpr bool rowReversed(uint8_t y) { return PANEL::rowReversed(y % PANEL::HEIGHT); }
+
+    /// @copydoc Layout::rowsReversed
+    static constexpr bool rowsReversed() { return false; }
+};
+
+#endif //LAYOUT_HPP
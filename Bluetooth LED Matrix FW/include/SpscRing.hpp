@@ -0,0 +1,60 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <Arduino.h>
+
+
+/**
+ * @class SpscRing
+ * @brief A lock-free ring buffer for a single producer and a single consumer, such as an interrupt and the main loop.
+ *
+ * The producer only writes the head and the consumer only writes the tail. Both are single bytes, which the MCU
+ * reads and writes atomically, so neither side has to disable interrupts. The indices run freely and wrap around,
+ * their difference is the number of items.
+ *
+ * @tparam T The type of the items.
+ * @tparam SIZE The number of items the ring holds, a power of two up to 128.
+ */
+template<typename T, uint8_t SIZE>
+class SpscRing {
+    static_assert(SIZE > 0 && SIZE <= 128 && (SIZE & (SIZE - 1)) == 0, "the size must be a power of two up to 128");
+
+    T items[SIZE]; ///< The items, indexed by the lower bits of the indices.
+    volatile uint8_t head = 0; ///< The index of the next item pushed, written by the producer only.
+    volatile uint8_t tail = 0; ///< The index of the next item popped, written by the consumer only.
+
+public:
+    /**
+     * @brief Add an item. Must only be called by the producer.
+     *
+     * @param item The item.
+     * @return False if the ring is full and the item has been dropped, true otherwise.
+     */
+    bool push(const T &item) {
+        uint8_t h = head;
+        if ((uint8_t) (h - tail) == SIZE) return false;
+        items[h & (SIZE - 1)] = item;
+        asm volatile("" ::: "memory"); // the item must be stored before it is published
+        head = h + 1;
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest item. Must only be called by the consumer.
+     *
+     * @param item Set to the item.
+     * @return False if the ring is empty, true otherwise.
+     */
+    bool pop(T &item) {
+        uint8_t t = tail;
+        if (t == head) return false;
+        asm volatile("" ::: "memory"); // the item must not be loaded before the head
+        item = items[t & (SIZE - 1)];
+        asm volatile("" ::: "memory"); // the item must be loaded before its slot is released
+        tail = t + 1;
+        return true;
+    }
+};
+
+
+#endif //SPSC_RING_HPP
@@ -0,0 +1,71 @@
+#ifndef STRIP_HPP
+#define STRIP_HPP
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "color.h"
+
+
+/**
+ * @class Strip
+ * @brief The LED strip of the matrix, able to show a frame other than its own pixel buffer.
+ *
+ * Effects and commands render into the pixel buffer of the strip and read it back (shifting, fading, GET_LEDS),
+ * so it must keep the rendered frame. The output stage composes the frame that is actually shown into a buffer
+ * of its own and sends it with show(frame), which leaves the pixel buffer untouched.
+ * Frames passed to show(frame) use the same layout as the pixel buffer: getBytesPerPixel() bytes per LED,
+ * in the color order of the strip.
+ */
+class Strip : public Adafruit_NeoPixel {
+public:
+    using Adafruit_NeoPixel::Adafruit_NeoPixel;
+    using Adafruit_NeoPixel::show;
+
+    /**
+     * @brief Send a frame to the LEDs instead of the pixel buffer.
+     *
+     * @param frame The frame of numPixels() * getBytesPerPixel() bytes.
+     */
+    void show(uint8_t *frame) {
+        uint8_t *own = pixels;
+        pixels = frame;
+        show();
+        pixels = own;
+    }
+
+    /**
+     * @brief Get the number of bytes a LED takes in the pixel buffer.
+     *
+     * @return 4 for RGBW strips, 3 otherwise.
+     */
+    uint8_t getBytesPerPixel() const { return wOffset == rOffset ? 3 : 4; }
+
+    /**
+     * @brief Get the color of a LED of a frame.
+     *
+     * @param frame The frame.
+     * @param i The index of the LED on the strip.
+     * @return The color of the LED.
+     */
+    color_t getColor(const uint8_t *frame, uint16_t i) const {
+        const uint8_t *p = frame + i * getBytesPerPixel();
+        return {p[rOffset], p[gOffset], p[bOffset]};
+    }
+
+    /**
+     * @brief Set the color of a LED of a frame, keeping its white component.
+     *
+     * @param frame The frame.
+     * @param i The index of the LED on the strip.
+     * @param c The color of the LED.
+     */
+    void setColor(uint8_t *frame, uint16_t i, const color_t &c) const {
+        uint8_t *p = frame + i * getBytesPerPixel();
+        p[rOffset] = c.r;
+        p[gOffset] = c.g;
+        p[bOffset] = c.b;
+    }
+};
+
+
+#endif //STRIP_HPP
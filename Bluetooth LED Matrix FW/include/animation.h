@@ -0,0 +1,76 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <Arduino.h>
+#include "Adafruit_NeoPixel.h"
+#include "protocol.h"
+#include "storage.h"
+
+/*
+ * ANIMATION
+ *      params: flags
+ *      flags bit 0 = loop, fading from the last keyframe back to the first one (default: stop at the last keyframe)
+ *      plays the keyframe animation stored in the EEPROM by writeAnimation(), starting at its first keyframe
+ *      every keyframe is reached by fading from the previous one with color_t::lerp()
+ *
+ * The animation is stored as:
+ *      length (2), palette size, keyframe count, [r, g, b] * palette size, [keyframe] * keyframe count
+ *      length = number of bytes of the whole animation including this header
+ *      1 to ANIMATION_MAX_COLORS colors, at least one keyframe
+ * A keyframe is stored as:
+ *      fade time (2), type, data
+ *      fade time = time in milliseconds the fade from the previous keyframe takes
+ *      the first keyframe is shown at once when the animation starts, its fade time is the one of the fade from
+ *      the last keyframe back to it when looping (flags bit 0), so 0 cuts back to the first keyframe without a fade
+ *      type 0x00 (full): [index << 4 | index] * ((leds + 1) / 2), the palette index of every led, the even led first
+ *      type 0x01 (sparse): count, [number (2), index] * count, the leds that change from the previous keyframe
+ */
+
+constexpr uint8_t ANIMATION_MAX_COLORS = 16; ///< The maximum size of the palette of an animation.
+
+/**
+ * @enum keyframe_t
+ * @brief The types of the keyframes of an animation.
+ */
+enum class keyframe_t : uint8_t {
+    FULL = 0x00, ///< The palette index of every LED.
+    SPARSE = 0x01, ///< The palette indices of the LEDs that change from the previous keyframe.
+};
+
+/**
+ * @brief Write a part of the animation into the EEPROM.
+ *
+ * The animation is written in chunks of at most STORAGE_CHUNK_SIZE bytes. Once the chunk that ends
+ * the animation has been written, the animation is validated.
+ *
+ * @param offset The offset of the chunk from the start of the animation.
+ * @param data The bytes of the chunk.
+ * @param count The number of bytes, at most STORAGE_CHUNK_SIZE.
+ * @return INVALID_ARGUMENT if the chunk exceeds the EEPROM region or completes an invalid animation, OK otherwise.
+ */
+state_t writeAnimation(uint16_t offset, const uint8_t *data, uint8_t count);
+
+/**
+ * @brief Start the animation at its first keyframe.
+ *
+ * @param leds The LED strip.
+ * @param params The parameters of the effect.
+ * @param scratch The scratch memory of the effect.
+ */
+void animationInit(Adafruit_NeoPixel &leds, const uint8_t *params, uint8_t *scratch);
+
+/**
+ * @brief Render the fade to the current keyframe, and continue with the next one once it has been reached.
+ *
+ * Only the palette indices of the two keyframes are kept, so a frame costs one interpolation per LED and
+ * the keyframes are read from the EEPROM just once per fade.
+ *
+ * @param leds The LED strip to render onto.
+ * @param t The time in milliseconds.
+ * @param params The parameters of the effect.
+ * @param scratch The scratch memory of the effect.
+ * @return False once the last keyframe has been reached and the animation does not loop, true otherwise.
+ */
+bool animationRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *params, uint8_t *scratch);
+
+#endif //ANIMATION_H
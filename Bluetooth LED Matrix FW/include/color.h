@@ -16,6 +16,27 @@ struct color_t {
     uint8_t g = 0; ///< The green component of the color.
     uint8_t b = 0; ///< The blue component of the color.
 
+    /**
+     * @brief Construct a new black color.
+     */
+    color_t() = default;
+
+    /**
+     * @brief Construct a new color from its components.
+     *
+     * @param r The red component of the color.
+     * @param g The green component of the color.
+     * @param b The blue component of the color.
+     */
+    constexpr color_t(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) {}
+
+    /**
+     * @brief Construct a new color from a color packed into a uint32_t, as returned by Adafruit_NeoPixel::getPixelColor().
+     *
+     * @param c The packed color.
+     */
+    explicit constexpr color_t(uint32_t c) : r((uint8_t) (c >> 16)), g((uint8_t) (c >> 8)), b((uint8_t) c) {}
+
     /**
      * @brief Compare this color with another color.
      *
@@ -35,31 +56,98 @@ struct color_t {
      * @brief Fade this color to another color.
      *
      * @param c The other color.
+     * @param step The largest change of a component, a component closer to the other color reaches it.
+     */
+    void fadeTo(const color_t &c, uint8_t step = 1) {
+        r = approach(r, c.r, step);
+        g = approach(g, c.g, step);
+        b = approach(b, c.b, step);
+    }
+
+    /**
+     * @brief Linearly interpolate between two colors using integer math only.
+     *
+     * The weights of both colors always sum up to 256, so every intermediate product fits into 16 bits.
+     *
+     * @param a The color returned for t = 0.
+     * @param b The color returned for t = 255.
+     * @param t The interpolation position in the range [0, 255].
+     * @return The interpolated color.
      */
-    void fadeTo(const color_t &c) {
-        if (r != c.r) r = (r < c.r) ? (r + 1) : (r - 1);
-        if (g != c.g) g = (g < c.g) ? (g + 1) : (g - 1);
-        if (b != c.b) b = (b < c.b) ? (b + 1) : (b - 1);
+    static color_t lerp(const color_t &a, const color_t &b, uint8_t t) {
+        uint16_t wb = t + (t >> 7); // map [0, 255] to [0, 256] so that t = 255 yields exactly b
+        uint16_t wa = 256 - wb;
+        return {
+                (uint8_t) ((a.r * wa + b.r * wb) >> 8),
+                (uint8_t) ((a.g * wa + b.g * wb) >> 8),
+                (uint8_t) ((a.b * wa + b.b * wb) >> 8),
+        };
+    }
+
+    /**
+     * @brief Get a fully saturated color from the color wheel.
+     *
+     * @param hue The position on the color wheel, starting at red, over green and blue back to red.
+     * @return The color at the position.
+     */
+    static color_t wheel(uint8_t hue) {
+        if (hue < 85) return {(uint8_t) (255 - hue * 3), (uint8_t) (hue * 3), 0};
+        if (hue < 170) {
+            hue -= 85;
+            return {0, (uint8_t) (255 - hue * 3), (uint8_t) (hue * 3)};
+        }
+        hue -= 170;
+        return {(uint8_t) (hue * 3), 0, (uint8_t) (255 - hue * 3)};
+    }
+
+    /**
+     * @brief Scale the brightness of the color.
+     *
+     * @param scale The brightness as fraction of 256, where 255 keeps the color.
+     * @return The scaled color.
+     */
+    color_t scaled(uint8_t scale) const {
+        return {
+                (uint8_t) (((uint16_t) r * (scale + 1)) >> 8),
+                (uint8_t) (((uint16_t) g * (scale + 1)) >> 8),
+                (uint8_t) (((uint16_t) b * (scale + 1)) >> 8),
+        };
     }
 
     /**
      * @brief Set the color to a random value.
+     *
+     * @param low The range of the two dim components, the third one takes the full range.
      */
-    void setRandom() {
+    void setRandom(uint8_t low = 8) {
         auto color = random(3);
-        r = getRnd(color == 0);
-        g = getRnd(color == 1);
-        b = getRnd(color == 2);
+        r = getRnd(color == 0, low);
+        g = getRnd(color == 1, low);
+        b = getRnd(color == 2, low);
     }
 
 private:
     /**
      * @brief Get a random value for a color component.
      *
-     * @param high If true, the random value will be in the range [0, 256), otherwise it will be in the range [0, 8).
+     * @param high If true, the random value will be in the range [0, 256), otherwise it will be in the range [0, low).
+     * @param low The range of a value that is not high.
      * @return The random value.
      */
-    static uint8_t getRnd(bool high) { return (uint8_t) random(high ? 256 : 8); }
+    static uint8_t getRnd(bool high, uint8_t low) { return (uint8_t) random(high ? 256 : low); }
+
+    /**
+     * @brief Move a component towards a value.
+     *
+     * @param v The component.
+     * @param target The value.
+     * @param step The largest change of the component.
+     * @return The moved component.
+     */
+    static uint8_t approach(uint8_t v, uint8_t target, uint8_t step) {
+        if (v < target) return target - v > step ? (uint8_t) (v + step) : target;
+        return v - target > step ? (uint8_t) (v - step) : target;
+    }
 };
 
 #endif
@@ -0,0 +1,51 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <Arduino.h>
+#include "protocol.h"
+#include "render.h"
+#include "text.h"
+
+/// The size of the parameters of INSERT_COLUMN or INSERT_ROW, the edge and the colors of the longer side of the matrix.
+constexpr uint16_t INSERT_PARAMS_SIZE = 1 + 3 * (MatrixLayout::WIDTH > MatrixLayout::HEIGHT
+                                                 ? MatrixLayout::WIDTH : MatrixLayout::HEIGHT);
+/// The size of the parameters of GRADIENT or SHOW_TEXT, whichever is larger.
+constexpr uint16_t TEXT_PARAMS_SIZE = 4 + GRADIENT_MAX_STOPS * 4 > 5 + TEXT_MAX_LENGTH
+                                      ? 4 + GRADIENT_MAX_STOPS * 4 : 5 + TEXT_MAX_LENGTH;
+/// The size of the buffer holding the parameters of a command while it is received
+/// (GRADIENT, SHOW_TEXT, INSERT_COLUMN or INSERT_ROW).
+constexpr uint16_t CMD_BUFFER_SIZE = INSERT_PARAMS_SIZE > TEXT_PARAMS_SIZE ? INSERT_PARAMS_SIZE : TEXT_PARAMS_SIZE;
+
+/**
+ * @brief Receive and execute commands from the Bluetooth serial connection.
+ *
+ * The commands are decoded byte by byte as they arrive, keeping the decoder state across calls,
+ * so this function never blocks waiting for data and needs no buffer for a whole frame.
+ * Pixels are written to the LED strip as soon as their color has been received, and the strip is shown
+ * once when the command is complete. A command is complete when its last byte has been received or,
+ * for commands of variable length and erroneous commands, when no data has been received for BT_IDLE_TIMEOUT milliseconds.
+ * The response is sent when the command is complete. Responses with the colors of many LEDs are sent in slices,
+ * one per call, and no command is received until the last slice has been sent.
+ */
+void btReceive();
+
+/**
+ * @brief Check whether a command is being received.
+ *
+ * Showing the LEDs disables interrupts, so data arriving meanwhile is lost. Animations should not be shown
+ * while a command is being received.
+ *
+ * @return True if the first bytes of a command have been received, but the command is not complete yet.
+ */
+bool btReceiving();
+
+/**
+ * @brief Check whether a response is still being sent in slices.
+ *
+ * The colors are read from the pixel buffer of the LED strip while they are sent, so it should not change meanwhile.
+ *
+ * @return True if btReceive() has to be called again to send the rest of the response.
+ */
+bool btResponding();
+
+#endif //COMMANDS_H
@@ -0,0 +1,92 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <Arduino.h>
+#include "Adafruit_NeoPixel.h"
+#include "Layout.hpp"
+
+/**
+ * @struct select_type
+ * @brief Select one of two types at compile time (the AVR toolchain ships without <type_traits>).
+ *
+ * @tparam CONDITION If true, type is T, otherwise type is F.
+ */
+template<bool CONDITION, typename T, typename F>
+struct select_type {
+    using type = T;
+};
+
+template<typename T, typename F>
+struct select_type<false, T, F> {
+    using type = F;
+};
+
+constexpr uint8_t NO_PIN = 0xFF; ///< Marks an optional pin that is not connected.
+
+/**
+ * @struct MatrixConfig
+ * @brief The compile-time configuration of the hardware the firmware is built for.
+ *
+ * It bundles the layout of the matrix with the LED type and the pins of the peripherals,
+ * so that differently sized matrices and chained panels can be built from the same source.
+ * All buffer sizes and index widths are derived from it at compile time.
+ *
+ * @tparam LAYOUT The layout of the matrix (Layout or TiledLayout).
+ * @tparam LED_TYPE The Adafruit_NeoPixel type flags of the LEDs (color order and data rate).
+ * @tparam LEDS_DATA_PIN The pin the data line of the LED strip is connected to.
+ * @tparam BLUETOOTH_RX_PIN The pin the RX line of the Bluetooth module is connected to.
+ * @tparam BLUETOOTH_TX_PIN The pin the TX line of the Bluetooth module is connected to.
+ * @tparam BUTTON_PIN The pin the button is connected to. Must be able to trigger an external interrupt.
+ * @tparam FRAME_DELAY The time between two frames of the animations in milliseconds.
+ * @tparam BLUETOOTH_STATE_PIN The pin the STATE line of the HC-05 is connected to, high while connected.
+ * NO_PIN if it is not connected. Must be able to trigger a pin change interrupt.
+ * @tparam INDEX The type used to iterate over the LEDs. Defaults to the smallest type that can count all LEDs.
+ */
+template<class LAYOUT, neoPixelType LED_TYPE, uint8_t LEDS_DATA_PIN,
+        uint8_t BLUETOOTH_RX_PIN, uint8_t BLUETOOTH_TX_PIN, uint8_t BUTTON_PIN, uint16_t FRAME_DELAY,
+        uint8_t BLUETOOTH_STATE_PIN = NO_PIN,
+        typename INDEX = typename select_type<(LAYOUT::COUNT < 256), uint8_t, uint16_t>::type>
+struct MatrixConfig {
+    using layout = LAYOUT; ///< The layout of the matrix.
+    using index_t = INDEX; ///< The type used to iterate over the LEDs.
+
+    static constexpr uint16_t LED_COUNT = LAYOUT::COUNT; ///< The number of LEDs of the matrix.
+    static constexpr neoPixelType LEDS_TYPE = LED_TYPE; ///< The Adafruit_NeoPixel type flags of the LEDs.
+    static constexpr uint8_t LEDS_PIN = LEDS_DATA_PIN; ///< The pin the data line of the LED strip is connected to.
+    static constexpr uint8_t BT_RX_PIN = BLUETOOTH_RX_PIN; ///< The pin the RX line of the Bluetooth module is connected to.
+    static constexpr uint8_t BT_TX_PIN = BLUETOOTH_TX_PIN; ///< The pin the TX line of the Bluetooth module is connected to.
+    static constexpr uint8_t BTN_PIN = BUTTON_PIN; ///< The pin the button is connected to.
+    static constexpr uint8_t BT_STATE_PIN = BLUETOOTH_STATE_PIN; ///< The pin of the STATE line, NO_PIN if unused.
+    static constexpr uint16_t DELAY = FRAME_DELAY; ///< The time between two frames of the animations in milliseconds.
+
+    /// The number of bytes the LED strip stores per pixel; RGBW types have a white offset different from the red one.
+    static constexpr uint8_t BYTES_PER_PIXEL = ((LED_TYPE >> 6) & 0x03) == ((LED_TYPE >> 4) & 0x03) ? 3 : 4;
+
+    static_assert((uint32_t) (index_t) ~(index_t) 0 >= LED_COUNT, "the index type is too small to count all LEDs");
+    static_assert(digitalPinToInterrupt(BUTTON_PIN) != NOT_AN_INTERRUPT, "the button pin must support interrupts");
+};
+
+/*
+ * Matrix presets, selected by a build flag of the PlatformIO environment:
+ *
+ * MATRIX_16X16
+ *      a single 16x16 serpentine panel, too large for the SRAM of a Nano
+ * MATRIX_CHAINED_2X1
+ *      two 8x8 panels next to each other, chained into one strip
+ * default
+ *      a single 8x8 panel wired row by row
+ */
+#if defined(MATRIX_16X16)
+using Matrix = MatrixConfig<Layout<16, 16, true>, NEO_GRB + NEO_KHZ800, 6, 11, 10, 2, 50>;
+#elif defined(MATRIX_CHAINED_2X1)
+using Matrix = MatrixConfig<TiledLayout<Layout<8, 8>, 2>, NEO_GRB + NEO_KHZ800, 11, 3, 4, 2, 50>;
+#else
+using Matrix = MatrixConfig<Layout<8, 8>, NEO_GRB + NEO_KHZ800, 11, 3, 4, 2, 50>;
+#endif
+
+using MatrixLayout = Matrix::layout; ///< The layout of the matrix the firmware is built for.
+
+constexpr uint16_t SRAM_SIZE = RAMEND - RAMSTART + 1; ///< The size of the SRAM of the MCU.
+constexpr uint16_t SRAM_RESERVE = 512; ///< The SRAM kept free for the stack, the Arduino core and small globals.
+
+#endif //CONFIG_H
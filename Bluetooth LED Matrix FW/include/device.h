@@ -0,0 +1,22 @@
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+#include "Strip.hpp"
+
+/**
+ * @enum mode_t
+ * @brief The modes of operation of the device.
+ */
+enum class mode_t {
+    OFF, ///< The LEDs are off and the device sleeps until the button is pressed or Bluetooth becomes active.
+    EFFECT, ///< The LEDs show the animation of the selected effect.
+    BT, ///< The LEDs show the colors set over Bluetooth.
+};
+
+extern SoftwareSerial btSer; ///< The serial connection to the Bluetooth module.
+extern Strip leds; ///< The LED strip of the matrix.
+extern volatile mode_t mode; ///< The current mode of operation.
+
+#endif //DEVICE_H
@@ -0,0 +1,99 @@
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+#include <Arduino.h>
+#include "Adafruit_NeoPixel.h"
+#include "color.h"
+#include "config.h"
+
+/**
+ * @enum effect_id_t
+ * @brief The IDs of the effects that are rendered on the device, as used by the Bluetooth protocol.
+ */
+enum class effect_id_t : uint8_t {
+    RANDOM = 0x00, ///< Every LED fades to a random color.
+    PLASMA = 0x01, ///< Overlapping sine waves mapped onto the color wheel.
+    FIRE = 0x02, ///< Flames rising from the bottom of the matrix.
+    RAIN = 0x03, ///< Drops falling down the columns, leaving a fading trail.
+    RAINBOW = 0x04, ///< The color wheel moving across the matrix.
+    BREATHING = 0x05, ///< The whole matrix slowly pulsing in a single color.
+    LIFE = 0x06, ///< A cellular automaton such as Conway's Game of Life.
+    TEXT = 0x07, ///< A text scrolling through the matrix.
+    ANIMATION = 0x08, ///< The keyframe animation stored in the EEPROM.
+    SHADER = 0x09, ///< The shader program stored in the EEPROM, run for every pixel.
+    PARTICLES = 0x0A, ///< Sparks, confetti or meteors drawn by a pool of particles.
+};
+
+constexpr uint8_t EFFECT_COUNT = 11; ///< The number of effects in the registry.
+constexpr uint8_t EFFECT_MAX_PARAMS = 8; ///< The maximum number of parameter bytes of an effect.
+constexpr uint8_t BENCHMARK_FRAMES = 32; ///< The number of frames rendered to find the longest one of an effect.
+
+/// The size of the memory shared by all effects for their state, as only one effect runs at a time.
+constexpr uint16_t EFFECT_SCRATCH_SIZE = Matrix::LED_COUNT * sizeof(color_t);
+
+/**
+ * @struct effect_t
+ * @brief An entry of the effect registry.
+ *
+ * Effects are stateless functions; all state lives in the shared scratch memory, which init() prepares.
+ * Parameters that are 0 select the default of the effect, so an effect can be started without any parameters.
+ */
+struct effect_t {
+    /// Prepare the scratch memory when the effect is selected; the LED strip still shows the previous frame.
+    void (*init)(Adafruit_NeoPixel &leds, const uint8_t *params, uint8_t *scratch);
+    /// Render the frame for the time t in milliseconds onto the LED strip without showing it; false if it is unchanged.
+    bool (*render)(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *params, uint8_t *scratch);
+    /// The time between two frames in milliseconds, 0 for the FRAME_DELAY parameter, see params.h.
+    uint16_t frameTime;
+};
+
+/**
+ * @brief Select the effect that is rendered by renderEffect(), fading over from the frame shown last.
+ *
+ * @param id The ID of the effect.
+ * @param params The parameters of the effect. Missing parameters are set to 0, selecting their default.
+ * @param count The number of parameters, at most EFFECT_MAX_PARAMS.
+ * @return False if there is no effect with the ID or there are too many parameters, true otherwise.
+ */
+bool selectEffect(uint8_t id, const uint8_t *params, uint8_t count);
+
+/**
+ * @brief Select the next effect of the registry with its default parameters.
+ */
+void nextEffect();
+
+/**
+ * @brief Get the ID of the selected effect.
+ *
+ * @return The ID of the effect.
+ */
+uint8_t selectedEffect();
+
+/**
+ * @brief Get the parameters of the selected effect.
+ *
+ * @return The EFFECT_MAX_PARAMS parameters, 0 for the ones not given.
+ */
+const uint8_t *effectParams();
+
+/**
+ * @brief Render the next frame of the selected effect if its frame time has passed, and show it with showFrame() if it has changed.
+ *
+ * @param leds The LED strip to render onto.
+ * @return The time in milliseconds until the next frame is due.
+ */
+uint16_t renderEffect(Adafruit_NeoPixel &leds);
+
+#ifdef BENCHMARK
+/**
+ * @brief Measure the longest time a frame of every effect takes to render and print it to the UART.
+ *
+ * Every effect is rendered for BENCHMARK_FRAMES frames with its default parameters, the particles also with
+ * their whole pool in use. The frames are not shown. The selected effect starts anew afterwards.
+ *
+ * @param leds The LED strip to render onto.
+ */
+void benchmarkEffects(Adafruit_NeoPixel &leds);
+#endif
+
+#endif //EFFECTS_H
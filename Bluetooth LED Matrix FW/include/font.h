@@ -0,0 +1,27 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+constexpr uint8_t FONT_WIDTH = 5; ///< The width of a glyph in columns.
+constexpr uint8_t FONT_HEIGHT = 7; ///< The height of a glyph in rows.
+constexpr char FONT_FIRST = ' '; ///< The first character of the font.
+constexpr char FONT_LAST = '~'; ///< The last character of the font.
+
+/// The glyphs of the printable ASCII characters, column by column from the left, bit 0 is the top row.
+extern const uint8_t FONT[FONT_LAST - FONT_FIRST + 1][FONT_WIDTH] PROGMEM;
+
+/**
+ * @brief Look up a column of the glyph of a character.
+ *
+ * @param c The character. Characters the font does not contain are shown as '?'.
+ * @param column The column of the glyph, counted from the left.
+ * @return The pixels of the column, bit 0 is the top row.
+ */
+inline uint8_t fontColumn(char c, uint8_t column) {
+    if (c < FONT_FIRST || c > FONT_LAST) c = '?';
+    return pgm_read_byte(&FONT[c - FONT_FIRST][column]);
+}
+
+#endif //FONT_H
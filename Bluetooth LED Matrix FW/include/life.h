@@ -0,0 +1,42 @@
+#ifndef LIFE_H
+#define LIFE_H
+
+#include <Arduino.h>
+#include "Adafruit_NeoPixel.h"
+
+/*
+ * LIFE
+ *      params: birth, survival, r, g, b, flags, generation time in 10 ms (default 20), seed
+ *      birth, survival = bit n - 1 is set if a cell is born / survives with n living neighbors (default B3/S23)
+ *      r, g, b = color of the living cells (default 0, 255, 64); dead cells fade out
+ *      flags bit 0 = bounded edges instead of wrapping around
+ *      flags bit 1 = seed from the current frame, every pixel that is not black is alive
+ *      flags bit 2 = use the survival mask as is, so that 0 means no cell survives
+ *      seed = seed of the random start population (0 = a different one every time)
+ *      the board is seeded randomly again once it dies out or stops changing
+ */
+
+/**
+ * @brief Seed the board of the cellular automaton.
+ *
+ * @param leds The LED strip, whose current frame may seed the board.
+ * @param params The parameters of the effect.
+ * @param scratch The scratch memory of the effect.
+ */
+void lifeInit(Adafruit_NeoPixel &leds, const uint8_t *params, uint8_t *scratch);
+
+/**
+ * @brief Advance the cellular automaton if the generation time has passed and render the board.
+ *
+ * The board is stored as one bit per cell, one machine word per row. All cells of a row are advanced at once:
+ * the eight neighbor rows are added with a bit-sliced counter, so each bit position holds its own neighbor count.
+ *
+ * @param leds The LED strip to render onto.
+ * @param t The time in milliseconds.
+ * @param params The parameters of the effect.
+ * @param scratch The scratch memory of the effect.
+ * @return Always true, as the dead cells fade out every frame.
+ */
+bool lifeRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *params, uint8_t *scratch);
+
+#endif //LIFE_H
@@ -0,0 +1,205 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <Arduino.h>
+#include "color.h"
+#include "config.h"
+#include "protocol.h"
+
+/*
+ * Output stage:
+ *
+ * Effects and commands render the base frame into the pixel buffer of the LED strip. The output stage composes
+ * the frame that is shown from it, so layers on top of the base frame never change what the effects read back.
+ * The composed frame is kept in a buffer of its own, the only additional frame of the firmware.
+ *
+ * The overlay is a sparse set of at most OVERLAY_MAX_PIXELS LEDs, each with a color and an alpha,
+ * which is blended over the base frame when it is shown:
+ *      ALPHA: the LED fades from the base color to the overlay color
+ *      MULTIPLY: the LED fades from the base color to the base color multiplied by the overlay color (a mask:
+ *          black hides the base color, white keeps it)
+ * Blending is done with 8 bit integer math only and just for the LEDs of the overlay.
+ *
+ * Transitions crossfade from the frame shown last to the new content over the transition time. They start
+ * whenever the mode or the effect changes. The composed frame is the state of the transition: every frame moves it
+ * towards the new content by the fraction of the remaining time that has passed, so it arrives exactly when the
+ * transition ends and no copy of the outgoing frame is needed. The overlay is blended over the transition.
+ * Turning the device off fades to black the same way, while the pixel buffer and the overlay stay unchanged,
+ * so the last frame fades in again from RAM when the device wakes up.
+ *
+ * The power limiter scales the brightness of the composed frame down if the current the LEDs would draw exceeds
+ * the power limit. The current is estimated from the sum of all channels, which is summed up while the frame is
+ * composed and corrected for the LEDs of the overlay, so only frames that exceed the limit take an extra pass.
+ *
+ * The global brightness is applied while the frame is composed as well, so the pixel buffer keeps the full colors.
+ * The fraction lost by scaling a channel down is spread over the following frames by temporal dithering, so low
+ * brightnesses keep the levels in between. Dithering needs frames to be shown repeatedly; effects and transitions
+ * do, a static frame set over Bluetooth is shown once and keeps its rounded levels.
+ *
+ * Frames can be staged: nothing is shown while they are, so the pixel buffer can be changed by any number of
+ * commands, until the frame is committed at an instant of the wall clock (see scheduler.h). Devices with
+ * synchronized clocks thus show their frames at the same time. Staged frames that are not committed within
+ * STAGE_TIMEOUT are shown anyway, so a lost commit does not freeze the LEDs.
+ */
+
+constexpr uint8_t OVERLAY_MAX_PIXELS = 16; ///< The maximum number of LEDs of the overlay.
+
+/**
+ * @enum blend_t
+ * @brief The ways the overlay is blended over the base frame.
+ */
+enum class blend_t : uint8_t {
+    ALPHA = 0x00, ///< Fade from the base color to the overlay color.
+    MULTIPLY = 0x01, ///< Fade from the base color to the product of the base color and the overlay color.
+};
+
+/// The size of the overlay in bytes.
+constexpr uint16_t OVERLAY_SIZE = OVERLAY_MAX_PIXELS * (sizeof(uint16_t) + sizeof(color_t) + 1) + 2;
+
+constexpr uint16_t TRANSITION_TIME = 400; ///< The default time of a transition in milliseconds.
+constexpr uint8_t TRANSITION_FRAME_TIME = 20; ///< The time between two frames of a transition in milliseconds.
+
+/// The time in milliseconds staged frames are held without a commit, and the furthest ahead a commit may be.
+constexpr uint16_t STAGE_TIMEOUT = 10000;
+
+constexpr uint16_t POWER_LIMIT = 1000; ///< The default current the LEDs may draw in milliamps.
+constexpr uint8_t LED_CHANNEL_CURRENT = 20; ///< The current of a channel of a LED at full brightness in milliamps.
+constexpr uint8_t LED_IDLE_CURRENT = 1; ///< The current of a LED when it is black in milliamps.
+
+/**
+ * @brief Set the way the overlay is blended over the base frame.
+ *
+ * @param blend The blend mode.
+ * @return INVALID_ARGUMENT if there is no such blend mode, OK otherwise.
+ */
+state_t setOverlayBlend(uint8_t blend);
+
+/**
+ * @brief Add a LED to the overlay, or change or remove it if it is part of the overlay already.
+ *
+ * @param n The logical number of the LED.
+ * @param c The color of the overlay.
+ * @param alpha The opacity of the overlay, 255 = opaque, 0 removes the LED from the overlay.
+ * @return LED_OUT_OF_RANGE if there is no such LED, INVALID_STATE if the overlay is full, OK otherwise.
+ */
+state_t setOverlayPixel(uint16_t n, const color_t &c, uint8_t alpha);
+
+/**
+ * @brief Remove all LEDs from the overlay.
+ */
+void clearOverlay();
+
+/**
+ * @brief Set the time of the transitions.
+ *
+ * @param time The time in milliseconds, 0 switches instantly.
+ */
+void setTransitionTime(uint16_t time);
+
+/**
+ * @brief Get the time of the transitions.
+ *
+ * @return The time in milliseconds.
+ */
+uint16_t getTransitionTime();
+
+/**
+ * @brief Set the current the LEDs may draw.
+ *
+ * @param limit The current in milliamps, 0 for no limit.
+ */
+void setPowerLimit(uint16_t limit);
+
+/**
+ * @brief Get the current the LEDs may draw.
+ *
+ * @return The current in milliamps, 0 for no limit.
+ */
+uint16_t getPowerLimit();
+
+/**
+ * @brief Set the brightness the frames are shown with.
+ *
+ * @param value The brightness, 255 shows the colors of the pixel buffer as they are.
+ */
+void setGlobalBrightness(uint8_t value);
+
+/**
+ * @brief Get the brightness the frames are shown with.
+ *
+ * @return The brightness.
+ */
+uint8_t getGlobalBrightness();
+
+/**
+ * @brief Start a transition from the frame shown last to the content shown next.
+ */
+void startTransition();
+
+/**
+ * @brief Start a crossfade from the frame shown last to the content of the current mode, taking the given time
+ * instead of the transition time. The mode is taken as shown, so a change of it does not start another transition.
+ *
+ * @param time The time of the crossfade in milliseconds, 0 to show the new content at once.
+ */
+void startFade(uint16_t time);
+
+/**
+ * @brief Check whether a transition is running.
+ *
+ * @return True if the frame shown last has not reached the new content yet.
+ */
+bool inTransition();
+
+/**
+ * @brief Stage the following frames: nothing is shown until they are committed.
+ */
+void stageFrames();
+
+/**
+ * @brief Commit the staged frames, which shows the pixel buffer once the wall clock reaches the given time.
+ *
+ * @param time The time of the wall clock in milliseconds.
+ * @return INVALID_STATE if no frames are staged, INVALID_ARGUMENT if the time is more than STAGE_TIMEOUT ahead,
+ * OK otherwise.
+ */
+state_t commitFrames(uint32_t time);
+
+/**
+ * @brief Check whether frames are staged.
+ *
+ * @return True until the staged frames are shown.
+ */
+bool framesStaged();
+
+/**
+ * @brief Get the time until the staged frames are shown, by their commit or the timeout.
+ *
+ * @return The time in milliseconds, saturating, 0 if they are due, UINT16_MAX if no frames are staged.
+ */
+uint16_t stagedDelay();
+
+/**
+ * @brief Compose the frame from the pixel buffer of the LED strip and send it to the LEDs.
+ *
+ * A transition is started first if the mode has changed since the last frame, and frameSync() is called after it.
+ * Nothing is done while frames are staged.
+ */
+void showFrame();
+
+/**
+ * @brief Show the next frame of a running transition once TRANSITION_FRAME_TIME has passed,
+ * as the content of the pixel buffer is not shown again unless it changes. A frame is shown as well if the mode has
+ * changed since the last one, which starts the transition, and when the staged frames are due.
+ */
+void updateOutput();
+
+#ifdef BENCHMARK
+/**
+ * @brief Measure the time it takes to compose a frame without and with dithering, and in the worst case
+ * (a transition with the whole overlay in use and the power limit exceeded), and print it to the UART.
+ */
+void benchmarkOutput();
+#endif
+
+#endif //OUTPUT_H
@@ -0,0 +1,100 @@
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <Arduino.h>
+#include "protocol.h"
+
+/*
+ * Parameters:
+ *
+ * The tunable constants of the firmware are kept in a table of typed parameters, each with a range and a default,
+ * which GET_PARAM and SET_PARAM read and write over Bluetooth. The values are cached in the SRAM, so reading one
+ * on the hot path is a plain load; they are persisted with the rest of the state, see persist.h.
+ *
+ * FRAME_DELAY (u16, 1 to 1000, default Matrix::DELAY)
+ *      the time between two frames of the RANDOM effect in milliseconds
+ * FADE_STEP (u8, 1 to 255, default 1)
+ *      the step every component of a LED of the RANDOM effect moves towards its target color per frame
+ * RANDOM_LOW (u8, 1 to 255, default 8)
+ *      the range of the two dim components of a random color, the third one takes the full range
+ * DEBOUNCE_TIME, LONG_PRESS_TIME, DOUBLE_CLICK_TIME, REPEAT_TIME (u8, u16, u16, u16)
+ *      the timing of the button in milliseconds, see Button
+ */
+
+/**
+ * @enum param_t
+ * @brief The IDs of the parameters.
+ */
+enum class param_t : uint8_t {
+    FRAME_DELAY = 0x00,
+    FADE_STEP = 0x01,
+    RANDOM_LOW = 0x02,
+    DEBOUNCE_TIME = 0x03,
+    LONG_PRESS_TIME = 0x04,
+    DOUBLE_CLICK_TIME = 0x05,
+    REPEAT_TIME = 0x06,
+};
+
+constexpr uint8_t PARAM_COUNT = 7; ///< The number of parameters.
+
+/**
+ * @enum param_type_t
+ * @brief The types of the parameters.
+ */
+enum class param_type_t : uint8_t {
+    U8 = 0x00, ///< An unsigned 8 bit value.
+    U16 = 0x01, ///< An unsigned 16 bit value.
+};
+
+/**
+ * @struct param_info_t
+ * @brief An entry of the parameter table.
+ */
+struct param_info_t {
+    param_type_t type; ///< The type of the value.
+    uint16_t min; ///< The smallest valid value.
+    uint16_t max; ///< The largest valid value.
+    uint16_t def; ///< The default value.
+};
+
+/**
+ * @brief Set all parameters to the defaults of the parameter table, without calling the parameter hook.
+ * Must be called before any parameter is read.
+ */
+void paramsBegin();
+
+/**
+ * @brief Get the value of a parameter.
+ *
+ * @param id The ID of the parameter.
+ * @return The cached value.
+ */
+uint16_t getParam(param_t id);
+
+/**
+ * @brief Set the value of a parameter and call the parameter hook.
+ *
+ * @param id The ID of the parameter.
+ * @param value The value.
+ * @return INVALID_ARGUMENT if there is no such parameter or the value is out of its range, OK otherwise.
+ */
+state_t setParam(uint8_t id, uint16_t value);
+
+/**
+ * @brief Get the entry of a parameter from the parameter table.
+ *
+ * @param id The ID of the parameter.
+ * @param info Set to the entry, with its default value.
+ * @return False if there is no such parameter, true otherwise.
+ */
+bool paramInfo(uint8_t id, param_info_t &info);
+
+/**
+ * @brief Set the function called after the value of a parameter has been set, to apply it where it is not read
+ * on every use.
+ *
+ * @param hook The function, nullptr for none.
+ */
+void setParamHook(void (*hook)());
+
+#endif //PARAMS_H
@@ -0,0 +1,75 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <Arduino.h>
+#include "Adafruit_NeoPixel.h"
+#include "color.h"
+#include "effects.h"
+
+/*
+ * PARTICLES
+ *      params: style, r, g, b, rate, trail
+ *      style 0 = sparks: bursts of particles flying apart and falling down (default)
+ *      style 1 = confetti: particles lighting up at random pixels and fading out
+ *      style 2 = meteors: particles crossing the matrix diagonally from the top
+ *      r, g, b = color of the particles (default: a color of the style)
+ *      rate = chance per frame out of 256 that new particles are spawned (default: depends on the style)
+ *      trail = brightness the frame keeps per frame out of 256 (default: depends on the style)
+ *      the particles are drawn with subpixel precision by splitting them onto the four pixels around them,
+ *      and are added onto the faded frame
+ *
+ * The particles are kept in a pool of a size fixed at compile time. Unused particles form a free list and
+ * living ones a list of their own, so spawning and removing a particle takes constant time and a frame only
+ * visits the living particles.
+ */
+
+/**
+ * @struct particle_t
+ * @brief A particle; positions are fixed-point numbers with 8 fractional bits.
+ */
+struct particle_t {
+    int16_t x; ///< The column in 1/256 pixels, counted from the left.
+    int16_t y; ///< The row in 1/256 pixels, counted from the top.
+    int8_t vx; ///< The velocity to the right in 1/64 pixels per frame.
+    int8_t vy; ///< The velocity downwards in 1/64 pixels per frame.
+    uint8_t life; ///< The frames until the particle disappears; it fades out during the last ones.
+    color_t color; ///< The color of the particle.
+    uint8_t next; ///< The index of the next particle of the same list, PARTICLE_NONE at its end.
+};
+
+/// The number of particles of the pool, as many as fit into the scratch memory of the effects.
+constexpr uint8_t PARTICLE_POOL_SIZE = (EFFECT_SCRATCH_SIZE - 2) / sizeof(particle_t) < 255
+                                       ? (EFFECT_SCRATCH_SIZE - 2) / sizeof(particle_t) : 254;
+
+constexpr uint8_t PARTICLE_NONE = 0xFF; ///< The index marking the end of a list of particles.
+
+/**
+ * @brief Empty the pool of particles.
+ *
+ * @param leds The LED strip.
+ * @param params The parameters of the effect.
+ * @param scratch The scratch memory of the effect.
+ */
+void particlesInit(Adafruit_NeoPixel &leds, const uint8_t *params, uint8_t *scratch);
+
+/**
+ * @brief Fade the frame, spawn new particles, move the living ones and add them onto the frame.
+ *
+ * @param leds The LED strip to render onto.
+ * @param t The time in milliseconds.
+ * @param params The parameters of the effect.
+ * @param scratch The scratch memory of the effect.
+ * @return Always true, as the frame fades every frame.
+ */
+bool particlesRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *params, uint8_t *scratch);
+
+#ifdef BENCHMARK
+/**
+ * @brief Fill the whole pool with particles moving inside the matrix, the worst case of a frame.
+ *
+ * @param scratch The scratch memory of the effect.
+ */
+void particlesFill(uint8_t *scratch);
+#endif
+
+#endif //PARTICLES_H
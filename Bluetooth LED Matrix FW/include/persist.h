@@ -0,0 +1,49 @@
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <Arduino.h>
+
+/*
+ * Persistence:
+ *
+ * The mode, the selected effect with its parameters, the settings of the output stage, the parameters of params.h
+ * and, in mode BT, the frame set over Bluetooth are kept in the EEPROM and restored at boot before the first frame
+ * is shown.
+ *
+ * Nothing has to report its changes: persistUpdate() takes a snapshot of the state every PERSIST_CHECK_TIME and
+ * compares it with the last one, the frame by a checksum. The state is written once it has not changed for
+ * PERSIST_DELAY, so a burst of commands causes a single write. Writing does not block: one byte is written per call,
+ * when the EEPROM has finished the previous one, and bytes that are unchanged are skipped.
+ *
+ * The states are written as records into a ring of STATE_SLOTS slots, each to the slot after the newest one,
+ * which spreads the wear over the ring. A record is valid if its checksum matches, so a record torn by a power loss
+ * is ignored and the one before it is restored. The frame is written before its record, which holds its checksum,
+ * so a torn frame is ignored as well. The frame is a single region, as a second copy does not fit into the EEPROM;
+ * it is only written while the mode is BT and only its changed bytes are.
+ */
+
+constexpr uint16_t PERSIST_CHECK_TIME = 250; ///< The time between two snapshots of the state in milliseconds.
+constexpr uint16_t PERSIST_DELAY = 2000; ///< The time the state must be unchanged before it is written in milliseconds.
+
+/**
+ * @brief Restore the state written last, if there is a valid one. Called at boot, before the first frame is shown.
+ *
+ * @return True if a state has been restored, false otherwise.
+ */
+bool restoreState();
+
+/**
+ * @brief Check the state for changes and continue writing it.
+ *
+ * @return The ticks until the function should be called again.
+ */
+uint16_t persistUpdate();
+
+/**
+ * @brief Check whether the state has been written since it has changed last.
+ *
+ * @return False while a changed state waits to be written or is being written, true otherwise.
+ */
+bool persistIdle();
+
+#endif //PERSIST_H
@@ -0,0 +1,303 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <Arduino.h>
+
+
+/*
+ * Bluetooth command structure (protocol version 2):
+ *
+ * Multi-byte values are sent big-endian (high byte first).
+ * Commands with a known length are executed and answered as soon as their last byte has been received.
+ * Commands of variable length (0x02) and erroneous commands are answered once no data has been received
+ * for BT_IDLE_TIMEOUT milliseconds.
+ * The protocol version only changes if existing commands change; added commands are discovered through 0x0D.
+ * While the device is turned off, it sleeps until data is received. The data received in the first 3 milliseconds
+ * after waking up is discarded, so send a single 0x00 and wait a few milliseconds before the first command.
+ * The device stays awake for 10 seconds after the last data, and while connected if the STATE line is wired.
+ *
+ * 0x01
+ *      get the color of all leds
+ *      1 byte: cmd
+ *      respond: cmd, status, ([number, r, g, b] * count)
+ *      only the first 256 leds are reported, use 0x0B for larger matrices
+ * 0x02
+ *      set some specific leds to a specific color
+ *      at most count * 4 + 1 bytes: cmd, [number, r, g, b] * count
+ *      respond: cmd, status
+ *      number = logical number of the led, counted row by row from the top left of the matrix
+ *      only the first 256 leds can be addressed, use 0x09 - 0x0C for larger matrices
+ * 0x03
+ *      set all leds to a specific color
+ *      4 bytes: cmd, r, g, b
+ *      respond: cmd, status
+ * 0x04
+ *      render a gradient onto the whole matrix
+ *      at most 4 + stops * 4 bytes: cmd, type, a, b, stops, [position, r, g, b] * stops
+ *      type 0x00 (linear): a, b = signed x and y components of the direction vector
+ *      type 0x01 (radial): a, b = x and y coordinates of the center
+ *      2 to 8 stops, sorted by position (0 - 255)
+ *      respond: cmd, status
+ * 0x05
+ *      render a two-colored pattern onto the whole matrix
+ *      9 bytes: cmd, type, size, r1, g1, b1, r2, g2, b2
+ *      type 0x00: checker, 0x01: vertical stripes, 0x02: horizontal stripes, 0x03: rings
+ *      size = size of a pattern cell in pixels (> 0)
+ *      respond: cmd, status
+ * 0x06
+ *      shift the content of the matrix in place
+ *      7 bytes: cmd, dx, dy, wrap, r, g, b
+ *      dx, dy = signed number of columns to the right and rows down
+ *      wrap 0x00: fill the vacated pixels with r, g, b; 0x01: wrap around
+ *      respond: cmd, status
+ * 0x07
+ *      shift the content of the matrix by one column and insert a new column at the vacated edge
+ *      2 + height * 3 bytes: cmd, edge, [r, g, b] * height (top to bottom)
+ *      edge 0x00: insert at the right edge (content moves left), 0x01: insert at the left edge
+ *      respond: cmd, status
+ * 0x08
+ *      shift the content of the matrix by one row and insert a new row at the vacated edge
+ *      2 + width * 3 bytes: cmd, edge, [r, g, b] * width (left to right)
+ *      edge 0x00: insert at the bottom edge (content moves up), 0x01: insert at the top edge
+ *      respond: cmd, status
+ * 0x09
+ *      set a range of consecutive leds to individual colors
+ *      5 + count * 3 bytes: cmd, start (2), count (2), [r, g, b] * count
+ *      respond: cmd, status
+ * 0x0A
+ *      set a range of consecutive leds to a single color
+ *      8 bytes: cmd, start (2), count (2), r, g, b
+ *      respond: cmd, status
+ * 0x0B
+ *      get the colors of a range of consecutive leds
+ *      5 bytes: cmd, start (2), count (2)
+ *      respond: cmd, status, (start (2), count (2), [r, g, b] * count)
+ * 0x0C
+ *      set some specific leds to a specific color, with 16 bit led numbers
+ *      3 + count * 5 bytes: cmd, count (2), [number (2), r, g, b] * count
+ *      respond: cmd, status
+ * 0x0D
+ *      get the capabilities of the device
+ *      1 byte: cmd
+ *      respond: cmd, status, version, width, height, leds (2), burst, idle timeout, commands (4), show time (2)
+ *      burst = number of bytes that may be sent without waiting for a response (receive buffer of the device)
+ *      idle timeout = BT_IDLE_TIMEOUT in milliseconds
+ *      commands = bit n is set if command n is supported
+ *      show time = time in microseconds it takes to send a frame to the leds, no data can be received meanwhile
+ * 0x0E
+ *      run an effect on the device until another command changes the leds
+ *      3 + count bytes: cmd, effect, count, [param] * count
+ *      at most 8 params, missing params and params that are 0 select the default of the effect
+ *      effect 0x00: random colors, no params
+ *      effect 0x01: plasma, params: speed, scale
+ *      effect 0x02: fire, params: cooling, sparking
+ *      effect 0x03: rain, params: r, g, b, density, trail
+ *      effect 0x04: rainbow, params: speed, scale, direction (0x00 horizontal, 0x01 vertical, 0x02 diagonal)
+ *      effect 0x05: breathing, params: r, g, b, period (in 100 ms)
+ *      effect 0x06: life, params: birth, survival, r, g, b, flags, generation time (in 10 ms), seed
+ *          birth, survival = bit n - 1 set if a cell is born / survives with n neighbors (default 0x04, 0x06: B3/S23)
+ *          flags bit 0: bounded edges, bit 1: seed from the current leds (not black = alive),
+ *          bit 2: survival 0x00 means no survival instead of the default
+ *          seed = seed of the random start population, 0x00 = random
+ *      effect 0x07: text set by 0x0F, params: r, g, b, step time (in 10 ms)
+ *      effect 0x08: keyframe animation written by 0x10, params: flags
+ *          flags bit 0: loop, fading from the last keyframe back to the first one (default: stop at the last one)
+ *          selecting the effect starts the animation at its first keyframe; the leds stay black if there is none
+ *      effect 0x09: shader program written by 0x11, params: read by the program (ARG)
+ *          the leds stay black if there is no valid program
+ *      effect 0x0A: particles, params: style, r, g, b, rate, trail
+ *          style 0x00: sparks, 0x01: confetti, 0x02: meteors; r, g, b = 0 selects the colors of the style
+ *          rate = chance per frame out of 256 that particles are spawned, trail = brightness kept per frame
+ *      respond: cmd, status
+ * 0x0F
+ *      scroll a text through the matrix
+ *      6 + length bytes: cmd, r, g, b, step time, length, [char] * length
+ *      step time = time in 10 ms the text takes to move by one column (0x00 = default)
+ *      at most 32 printable ASCII characters, others are shown as '?'
+ *      respond: cmd, status
+ * 0x10
+ *      write a chunk of the keyframe animation played by effect 0x08 into the EEPROM
+ *      4 + count bytes: cmd, offset (2), count, [byte] * count
+ *      at most 32 bytes per chunk; wait for the response before sending the next chunk (about 3.4 ms per byte)
+ *      the animation is validated once the chunk reaching its length has been written (invalid argument if it fails)
+ *      animation: length (2), palette size, keyframes, [r, g, b] * palette size, [keyframe] * keyframes
+ *          length = number of bytes of the whole animation (at most 256), 1 to 16 colors, at least 1 keyframe
+ *      keyframe: fade time (2), type, data
+ *          fade time = time in milliseconds the fade from the previous keyframe takes
+ *          type 0x00 (full): [index << 4 | index] * ((leds + 1) / 2), palette index of every led, even led first
+ *          type 0x01 (sparse): count, [number (2), index] * count, palette index of the leds that change
+ *          the first keyframe starts from all leds having palette index 0
+ *      respond: cmd, status
+ * 0x11
+ *      write a chunk of the shader program run by effect 0x09 into the EEPROM
+ *      4 + count bytes: cmd, offset (2), count, [byte] * count
+ *      chunks and validation as for 0x10
+ *      program: length (2), palette size, [r, g, b] * palette size, [code] * (length - 3 - palette size * 3)
+ *          length = number of bytes of the whole program (at most 128), 0 to 16 colors, 1 to 64 bytes of code
+ *      the code runs once per pixel on a stack of up to 8 bytes, arithmetic wraps around unless stated otherwise:
+ *          0x00 PUSH n, 0x01 X, 0x02 Y, 0x03 T (time in 16 ms), 0x04 I (led number), 0x05 ARG n (effect param n),
+ *          0x06 DUP, 0x07 SWAP, 0x08 DROP, 0x09 OVER,
+ *          0x0A ADD, 0x0B SUB, 0x0C MUL, 0x0D SCALE (a * b / 256), 0x0E AND, 0x0F OR, 0x10 XOR,
+ *          0x11 MIN, 0x12 MAX, 0x13 LT, 0x14 EQ (255 if true, 0 otherwise), 0x15 QADD, 0x16 QSUB (saturating),
+ *          0x17 SHL n, 0x18 SHR n, 0x19 NOT (255 - a), 0x1A SIN, 0x1B COS, 0x1C NOISE (x, y, 16 per cell),
+ *          0x1D JZ n (pop, skip n bytes if 0), 0x1E JMP n (skip n bytes),
+ *          0x1F RGB (pop r, g, b), 0x20 HUE (pop color wheel position), 0x21 PAL (pop palette position)
+ *      the color of a pixel is the last one output (black if none); jumps only go forward
+ *      programs whose worst case exceeds 8 ms per frame are invalid
+ *      respond: cmd, status
+ * 0x12
+ *      draw some specific leds over the content of the matrix, which itself stays unchanged
+ *      3 + count * 6 bytes: cmd, blend, count, [number (2), r, g, b, alpha] * count
+ *      blend 0x00 (alpha): the led fades from its color to r, g, b by alpha
+ *      blend 0x01 (multiply): the led fades from its color to its color multiplied by r, g, b (a mask) by alpha
+ *      alpha = opacity (0xFF = opaque), 0x00 removes the led from the overlay
+ *      the blend mode applies to the whole overlay, which keeps up to 16 leds across commands
+ *      the overlay stays over effects and over leds set by other commands; status 0xFE if it is full
+ *      respond: cmd, status
+ * 0x13
+ *      remove all leds from the overlay
+ *      1 byte: cmd
+ *      respond: cmd, status
+ * 0x14
+ *      set the time of the crossfade shown when the mode or the effect changes, and when the device turns off
+ *      3 bytes: cmd, time (2)
+ *      time = time in milliseconds (default 400), 0x0000 switches instantly
+ *      respond: cmd, status
+ * 0x15
+ *      limit the current drawn by the leds by scaling down the brightness of frames that would exceed it
+ *      3 bytes: cmd, limit (2)
+ *      limit = current in milliamps (default 1000), 0x0000 = no limit
+ *      the current is estimated with 20 mA per channel at full brightness and 1 mA per led
+ *      the colors reported by 0x01 and 0x0B are not affected
+ *      respond: cmd, status
+ * 0x16
+ *      set the brightness of the leds
+ *      2 bytes: cmd, brightness
+ *      brightness = 0x00 (off) to 0xFF (full, default)
+ *      the colors reported by 0x01 and 0x0B are not affected; effects and crossfades dither the levels in between
+ *      respond: cmd, status
+ * 0x17
+ *      get the runtime accounting of the tasks of the firmware since the last request, and reset it
+ *      1 byte: cmd
+ *      respond: cmd, status, frames (2), count, [runs (2), late (2), max (2), time (4)] * count, idle (4), wake (2),
+ *          pixel (2), command (2)
+ *      frames = number of frames shown, count = number of tasks (0: button, 1: bluetooth, 2: frame, 3: persistence)
+ *      runs = number of runs, late = number of runs that started after their deadline,
+ *      max, time = longest and total time of the runs in microseconds (the wire time of frames is mostly missed)
+ *      idle = time asleep in microseconds while no task was due, wake = longest latency from a tick to the
+ *          firmware running again in microseconds
+ *      pixel, command = time from the boot to the first frame shown and to the first command executed in milliseconds,
+ *          not reset (the first frame is shown before the Bluetooth module is ready)
+ * 0x18
+ *      store the colors of the leds as scene into a slot
+ *      2 bytes: cmd, slot
+ *      slot = 0x00 to 0x02 (EEPROM, kept when powered off; 0x00 only for the chained matrices) or
+ *          0x80 to 0x81 (SRAM, lost on reset; 0x80 only for the chained matrices)
+ *      the leds must show at most 16 different colors, else the status is 0xFE
+ *      a slot in the EEPROM takes up to 400 ms to be written, the response is sent once it has been written
+ *      respond: cmd, status
+ * 0x19
+ *      recall the scene of a slot, setting the colors of the leds to it and crossfading to it
+ *      4 bytes: cmd, slot, fade time (2)
+ *      fade time = time in milliseconds the crossfade takes, 0 to show the scene at once
+ *      the status is 0xFE if the slot is empty
+ *      respond: cmd, status
+ * 0x1A
+ *      move the wall clock of the device, which times COMMIT_AT
+ *      5 bytes: cmd, adjust (4)
+ *      adjust = signed time in milliseconds the clock is moved forward, 0 to read it only
+ *      respond: cmd, status, clock (4)
+ *      clock = time of the wall clock in milliseconds after the adjustment, wrapping around
+ *      to synchronize: send adjust 0 at host time t0, receive clock at t1, then send adjust = (t0 + t1) / 2 - clock
+ *          (in the time of the host); repeat to verify; the clock must be synchronized again after power-down
+ * 0x1B
+ *      stage the following frames: nothing is shown until they are committed, the leds can be changed by any commands
+ *      1 byte: cmd
+ *      frames not committed within 10 s are shown anyway
+ *      respond: cmd, status
+ * 0x1C
+ *      commit the staged frames, showing the colors of the leds once the wall clock reaches the given time
+ *      5 bytes: cmd, time (4)
+ *      time = time of the wall clock in milliseconds, at most 10 s ahead; a time passed already shows them at once
+ *      the status is 0xFE if no frames are staged
+ *      no command should be sent until the commit, as the frames are not shown while a command is being received
+ *      respond: cmd, status
+ * 0x1D
+ *      get a tunable parameter of the firmware
+ *      2 bytes: cmd, id
+ *      id = 0x00 frame delay of RANDOM (ms), 0x01 fade step of RANDOM, 0x02 range of the dim components of random
+ *          colors, 0x03 debounce time (ms), 0x04 long press time (ms), 0x05 double click time (ms),
+ *          0x06 repeat time (ms, 0 = none); the status is 0x03 for an unknown id, so the parameters can be listed
+ *      respond: cmd, status, type, value (2), min (2), max (2), default (2)
+ *      type = 0x00 (8 bit) or 0x01 (16 bit)
+ * 0x1E
+ *      set a tunable parameter of the firmware, it is persisted with the state
+ *      4 bytes: cmd, id, value (2)
+ *      the status is 0x03 for an unknown id or a value out of the range reported by 0x1D
+ *      respond: cmd, status
+ *
+ * respond codes:
+ *      0x00: success
+ *      0x01: invalid data length
+ *      0x02: led number out of range
+ *      0x03: invalid argument
+ *      0xFE: invalid state
+ *      0xFF: invalid command
+ */
+
+
+constexpr uint8_t PROTOCOL_VERSION = 2; ///< The version of the Bluetooth protocol implemented by the firmware.
+constexpr uint8_t BT_IDLE_TIMEOUT = 20; ///< The time in milliseconds without data after which a command is considered complete.
+
+/**
+ * @enum cmd_t
+ * @brief The command codes of the Bluetooth protocol.
+ */
+enum class cmd_t {
+    NONE = 0x00,
+    GET_LEDS = 0x01,
+    SET_LEDS = 0x02,
+    SET_LEDS_ALL = 0x03,
+    GRADIENT = 0x04,
+    PATTERN = 0x05,
+    SHIFT = 0x06,
+    INSERT_COLUMN = 0x07,
+    INSERT_ROW = 0x08,
+    SET_RANGE = 0x09,
+    FILL_RANGE = 0x0A,
+    GET_RANGE = 0x0B,
+    SET_LEDS_16 = 0x0C,
+    GET_INFO = 0x0D,
+    SET_EFFECT = 0x0E,
+    SHOW_TEXT = 0x0F,
+    WRITE_ANIMATION = 0x10,
+    WRITE_SHADER = 0x11,
+    SET_OVERLAY = 0x12,
+    CLEAR_OVERLAY = 0x13,
+    SET_TRANSITION = 0x14,
+    SET_POWER_LIMIT = 0x15,
+    SET_BRIGHTNESS = 0x16,
+    GET_TASKS = 0x17,
+    STORE_SCENE = 0x18,
+    RECALL_SCENE = 0x19,
+    SYNC_CLOCK = 0x1A,
+    STAGE = 0x1B,
+    COMMIT_AT = 0x1C,
+    GET_PARAM = 0x1D,
+    SET_PARAM = 0x1E,
+};
+
+/**
+ * @enum state_t
+ * @brief The respond codes of the Bluetooth protocol.
+ */
+enum class state_t {
+    OK = 0x00,
+    INVALID_DATA_LENGTH = 0x01,
+    LED_OUT_OF_RANGE = 0x02,
+    INVALID_ARGUMENT = 0x03,
+    INVALID_STATE = 0xFE,
+    INVALID_COMMAND = 0xFF,
+};
+
+#endif //PROTOCOL_H
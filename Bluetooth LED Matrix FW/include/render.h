@@ -0,0 +1,92 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <Arduino.h>
+#include "Adafruit_NeoPixel.h"
+#include "color.h"
+#include "config.h"
+
+/**
+ * @enum gradient_t
+ * @brief The shapes of gradient that can be rendered on the device.
+ */
+enum class gradient_t : uint8_t {
+    LINEAR = 0x00, ///< The colors change along a direction vector.
+    RADIAL = 0x01, ///< The colors change with the distance to a center point.
+};
+
+/**
+ * @enum pattern_t
+ * @brief The two-colored patterns that can be rendered on the device.
+ */
+enum class pattern_t : uint8_t {
+    CHECKER = 0x00, ///< A checkerboard of size x size cells.
+    STRIPES_VERTICAL = 0x01, ///< Vertical stripes of the given width.
+    STRIPES_HORIZONTAL = 0x02, ///< Horizontal stripes of the given width.
+    RINGS = 0x03, ///< Concentric rings of the given width around the center of the matrix.
+};
+
+/**
+ * @struct gradient_stop_t
+ * @brief A color stop of a gradient.
+ */
+struct gradient_stop_t {
+    uint8_t pos; ///< The position of the stop along the gradient in the range [0, 255].
+    color_t color; ///< The color at the position of the stop.
+};
+
+constexpr uint8_t GRADIENT_MIN_STOPS = 2; ///< The minimum number of color stops a gradient must have.
+constexpr uint8_t GRADIENT_MAX_STOPS = 8; ///< The maximum number of color stops a gradient may have.
+
+/**
+ * @brief Render a gradient onto the LED matrix.
+ *
+ * All 2D functions address the pixels through MatrixLayout, so they are independent of the wiring of the panel.
+ *
+ * For a linear gradient, the parameters a and b are the signed x and y components of the direction vector.
+ * The gradient spans the whole matrix along this direction.
+ * For a radial gradient, the parameters a and b are the x and y coordinates of the center point.
+ * The gradient spans from the center to the corner farthest away.
+ * The color of a pixel is interpolated between the two surrounding stops;
+ * pixels before the first or after the last stop take the color of that stop.
+ *
+ * @param leds The LED strip to render onto. The pixels are not shown.
+ * @param kind The shape of the gradient.
+ * @param a The first shape parameter.
+ * @param b The second shape parameter.
+ * @param stops The color stops, sorted by their position.
+ * @param count The number of color stops.
+ * @return False if the parameters are invalid, true otherwise.
+ */
+bool renderGradient(Adafruit_NeoPixel &leds, gradient_t kind, uint8_t a, uint8_t b, const gradient_stop_t *stops, uint8_t count);
+
+/**
+ * @brief Render a two-colored pattern onto the LED matrix.
+ *
+ * @param leds The LED strip to render onto. The pixels are not shown.
+ * @param kind The pattern to render.
+ * @param size The size of a pattern cell in pixels. Must not be 0.
+ * @param c1 The first color of the pattern.
+ * @param c2 The second color of the pattern.
+ * @return False if the parameters are invalid, true otherwise.
+ */
+bool renderPattern(Adafruit_NeoPixel &leds, pattern_t kind, uint8_t size, const color_t &c1, const color_t &c2);
+
+/**
+ * @brief Shift the content of the LED matrix in place.
+ *
+ * If the logical rows are contiguous on the strip, the pixel buffer of the LED strip is moved with memmove,
+ * row by row for horizontal shifts and as a whole for vertical shifts, taking the direction of each row into account.
+ * Otherwise, the pixels are moved one by one through the layout mapping. In both cases no frame needs to be re-sent.
+ * Pixels shifted out of the matrix either wrap around to the opposite edge or are discarded,
+ * in which case the vacated pixels are set to the fill color.
+ *
+ * @param leds The LED strip to shift. The pixels are not shown.
+ * @param dx The number of columns to shift to the right (negative values shift to the left).
+ * @param dy The number of rows to shift down (negative values shift up).
+ * @param wrap True if the shifted out pixels wrap around, false if the vacated pixels are filled.
+ * @param fill The color of the vacated pixels if wrap is false.
+ */
+void shiftPixels(Adafruit_NeoPixel &leds, int8_t dx, int8_t dy, bool wrap, const color_t &fill);
+
+#endif //RENDER_H
@@ -0,0 +1,71 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <Arduino.h>
+#include "protocol.h"
+#include "storage.h"
+
+/*
+ * Scenes:
+ *
+ * A scene is a frame stored palette-compressed in a slot, so it is shown again by a command of a few bytes
+ * instead of uploading the whole frame. The slots 0 to SCENE_SLOTS - 1 are kept in the EEPROM, the slots
+ * SCENE_RAM to SCENE_RAM + SCENE_RAM_SLOTS - 1 in the SRAM, where they are lost on reset but stored at once.
+ *
+ * A scene is stored as:
+ *      colors, [r, g, b] * SCENE_MAX_COLORS, [index << 4 | index] * ((leds + 1) / 2), check (2)
+ *      colors = number of colors of the palette, 1 to SCENE_MAX_COLORS, the unused entries are 0
+ *      the palette index of every led, in the order of the strip, the even led first, as the keyframes of the animation
+ *      check = checksum of all bytes before it, see checksumAdd(), so an erased or torn slot is empty
+ *
+ * Storing into the EEPROM takes about 3.4 ms per changed byte, so it proceeds one byte per call of storeSceneNext(),
+ * the check last. The pixel buffer must not change meanwhile, which the command decoder ensures by handling the
+ * store as a response being sent, see btResponding().
+ */
+
+constexpr uint8_t SCENE_MAX_COLORS = 16; ///< The maximum size of the palette of a scene.
+constexpr uint8_t SCENE_RAM = 0x80; ///< The number of the first slot in the SRAM.
+/// The number of slots in the SRAM, fewer on large matrices, as their LED buffers leave less SRAM.
+constexpr uint8_t SCENE_RAM_SLOTS = Matrix::LED_COUNT > 64 ? 1 : 2;
+/// The SRAM taken by the scenes, the slots and the palette of the scene being stored into the EEPROM.
+constexpr uint16_t SCENE_RAM_SIZE = SCENE_RAM_SLOTS * SCENE_SIZE + SCENE_MAX_COLORS * 3;
+
+static_assert(SCENE_SIZE == 1 + SCENE_MAX_COLORS * 3 + (Matrix::LED_COUNT + 1) / 2 + 2,
+              "the size of the scene slots of the EEPROM must match the format of the scenes");
+
+/**
+ * @brief Store the pixel buffer of the LED strip as scene.
+ *
+ * A slot in the SRAM is stored at once. A slot in the EEPROM is stored by storeSceneNext() until storingScene()
+ * turns false, the pixel buffer must not change meanwhile.
+ *
+ * @param slot The number of the slot.
+ * @return INVALID_ARGUMENT if there is no such slot, INVALID_STATE if the frame has more than SCENE_MAX_COLORS colors
+ * or a scene is still being stored, OK otherwise.
+ */
+state_t storeScene(uint8_t slot);
+
+/**
+ * @brief Continue storing a scene into the EEPROM. Writes at most one byte, once the EEPROM is ready.
+ *
+ * @return True once the scene has been stored, false while it is still being stored.
+ */
+bool storeSceneNext();
+
+/**
+ * @brief Check whether a scene is being stored into the EEPROM.
+ *
+ * @return True until the scene has been stored.
+ */
+bool storingScene();
+
+/**
+ * @brief Set the pixel buffer of the LED strip to a scene and the mode to BT, crossfading to it.
+ *
+ * @param slot The number of the slot.
+ * @param fade The time of the crossfade in milliseconds, 0 to show the scene at once.
+ * @return INVALID_ARGUMENT if there is no such slot, INVALID_STATE if the slot is empty or being stored, OK otherwise.
+ */
+state_t recallScene(uint8_t slot, uint16_t fade);
+
+#endif //SCENES_H
@@ -0,0 +1,180 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+/*
+ * Scheduler:
+ *
+ * Timer1 ticks every SCHEDULER_TICK microseconds. The tasks are run cooperatively from loop(): every call of
+ * schedule() runs the first task in the order of the table that is due, so earlier tasks take precedence.
+ * A task returns the number of ticks until it is due again, which lets it adapt its period, such as the frame time
+ * of the selected effect. Long-running work is split into slices by returning 0, so the task is due again at once,
+ * but only after the tasks before it in the table.
+ *
+ * Every task has a deadline, the number of ticks it may start after it was due. The runs, the runs that missed their
+ * deadline and the time spent in each task are counted for profiling. The time is measured with micros(),
+ * which misses most of the time interrupts are disabled, so runs that show a frame are short by most of its wire time.
+ * Ticks that elapse while interrupts are disabled (showing a frame) are delayed up to the end of it,
+ * and all but one are lost, like the ticks of millis().
+ *
+ * When no task is due, idle() puts the MCU into SLEEP_MODE_IDLE until the next interrupt: the tick, the overflow of
+ * Timer0 behind millis(), or a pin change of the Bluetooth serial. The time asleep and the wake latency, the time
+ * from the tick that ended the sleep to the first instruction after it, are measured as well.
+ *
+ * The time from the start of the firmware to the first frame shown and to the first command executed is recorded
+ * once, to measure the boot.
+ *
+ * The wall clock is the time of millis() moved by an offset, which the host adjusts to its own clock, so several
+ * devices can act at the same instant. millis() stops during power-down, so the clock must be adjusted again after it.
+ */
+
+constexpr uint16_t SCHEDULER_TICK = 1000; ///< The time between two ticks in microseconds.
+constexpr uint8_t SCHEDULER_MAX_TASKS = 4; ///< The maximum number of tasks.
+
+/**
+ * @struct task_t
+ * @brief An entry of the task table.
+ */
+struct task_t {
+    /// Run a slice of the task and return the number of ticks until it is due again, 0 to continue as soon as possible.
+    uint16_t (*run)();
+    /// The number of ticks the task may start after it was due before the run counts as late.
+    uint8_t deadline;
+};
+
+/**
+ * @struct task_stats_t
+ * @brief The runtime accounting of a task.
+ */
+struct task_stats_t {
+    uint16_t runs; ///< The number of runs.
+    uint16_t late; ///< The number of runs that started after their deadline.
+    uint16_t maxTime; ///< The longest run in microseconds, saturating.
+    uint32_t time; ///< The time of all runs in microseconds.
+};
+
+/**
+ * @brief Start the timer and make all tasks due.
+ *
+ * @param tasks The task table in the flash memory, in the order of precedence.
+ * @param count The number of tasks, at most SCHEDULER_MAX_TASKS.
+ */
+void schedulerBegin(const task_t *tasks, uint8_t count);
+
+/**
+ * @brief Run the first task that is due.
+ *
+ * @return True if a task has been run, false if none was due.
+ */
+bool schedule();
+
+/**
+ * @brief Sleep until the next interrupt, keeping the timers and the UART running. Called when no task is due.
+ *
+ * A tick arriving between schedule() and idle() is handled when the next interrupt wakes the MCU,
+ * at most about one tick later, as the overflow of Timer0 keeps waking it.
+ */
+void idle();
+
+/**
+ * @brief Get the number of ticks since the scheduler has been started, wrapping around.
+ *
+ * @return The number of ticks.
+ */
+uint16_t ticks();
+
+/**
+ * @brief Get the wall clock.
+ *
+ * @return The time of the wall clock in milliseconds, wrapping around.
+ */
+uint32_t wallClock();
+
+/**
+ * @brief Move the wall clock.
+ *
+ * @param adjust The time the wall clock is moved forward in milliseconds, negative to move it back.
+ */
+void adjustClock(int32_t adjust);
+
+/**
+ * @brief Set the function called from the interrupt of every tick, such as sampling inputs. It must be short.
+ *
+ * @param hook The function, nullptr for none.
+ */
+void setTickHook(void (*hook)());
+
+/**
+ * @brief Set the function called whenever a frame has been shown.
+ *
+ * @param hook The function, nullptr for none.
+ */
+void setFrameHook(void (*hook)());
+
+/**
+ * @brief Count a frame that has been shown and call the frame hook. Called by the output stage after every frame.
+ */
+void frameSync();
+
+/**
+ * @brief Record the first command executed. Called by the command decoder after every command.
+ */
+void commandSync();
+
+/**
+ * @brief Get the number of tasks.
+ *
+ * @return The number of tasks of the table.
+ */
+uint8_t taskCount();
+
+/**
+ * @brief Get the runtime accounting of a task since the last reset.
+ *
+ * @param task The index of the task in the table.
+ * @return The runtime accounting.
+ */
+const task_stats_t &taskStats(uint8_t task);
+
+/**
+ * @brief Get the number of frames shown since the last reset.
+ *
+ * @return The number of frames.
+ */
+uint16_t shownFrames();
+
+/**
+ * @brief Get the time spent asleep in idle() since the last reset.
+ *
+ * @return The time in microseconds.
+ */
+uint32_t idleTime();
+
+/**
+ * @brief Get the longest wake latency from a tick since the last reset.
+ *
+ * @return The latency in microseconds.
+ */
+uint16_t maxWakeLatency();
+
+/**
+ * @brief Get the time from the start of the firmware to the first frame shown. It is not reset.
+ *
+ * @return The time in milliseconds, saturating, 0 if no frame has been shown yet.
+ */
+uint16_t firstFrameTime();
+
+/**
+ * @brief Get the time from the start of the firmware to the first command executed. It is not reset.
+ *
+ * @return The time in milliseconds, saturating, 0 if no command has been executed yet.
+ */
+uint16_t firstCommandTime();
+
+/**
+ * @brief Reset the runtime accounting of all tasks and idle(), and the number of frames.
+ */
+void resetTaskStats();
+
+#endif //SCHEDULER_H
@@ -0,0 +1,109 @@
+#ifndef SHADER_H
+#define SHADER_H
+
+#include <Arduino.h>
+#include "Adafruit_NeoPixel.h"
+#include "protocol.h"
+#include "storage.h"
+
+/*
+ * SHADER
+ *      params: passed to the program, see op_t::ARG
+ *      runs the program stored in the EEPROM by writeShader() once for every pixel of every frame
+ *
+ * The program is stored as:
+ *      length (2), palette size, [r, g, b] * palette size, [code] * (length - 3 - palette size * 3)
+ *      length = number of bytes of the whole program including this header
+ *      0 to SHADER_MAX_COLORS colors, 1 to SHADER_MAX_CODE bytes of code
+ *
+ * The code runs on a stack of bytes; all arithmetic wraps around unless stated otherwise.
+ * Jumps only go forward, so every instruction runs at most once per pixel. This bounds the time of a frame,
+ * which is checked against SHADER_CYCLE_BUDGET when the program is written, together with the depth of the stack.
+ * The pixel keeps the color of the last output instruction, black if there is none.
+ */
+
+constexpr uint8_t SHADER_MAX_COLORS = 16; ///< The maximum size of the palette of a program.
+constexpr uint8_t SHADER_MAX_CODE = 64; ///< The maximum number of bytes of code of a program.
+constexpr uint8_t SHADER_STACK_SIZE = 8; ///< The maximum depth of the stack of a program.
+constexpr uint32_t SHADER_CYCLE_BUDGET = F_CPU / 1000 * 8; ///< The CPU cycles a frame may take at most (8 ms).
+constexpr uint8_t SHADER_PIXEL_CYCLES = 120; ///< The CPU cycles spent per pixel outside of the program.
+
+/**
+ * @enum op_t
+ * @brief The instructions of a shader program, followed by their stack effect (popped -- pushed).
+ */
+enum class op_t : uint8_t {
+    PUSH = 0x00, ///< -- imm: push the byte following the instruction.
+    X = 0x01, ///< -- x: push the column of the pixel, counted from the left.
+    Y = 0x02, ///< -- y: push the row of the pixel, counted from the top.
+    T = 0x03, ///< -- t: push the time in units of 16 ms, wrapping around after about 4 s.
+    I = 0x04, ///< -- i: push the low byte of the logical number of the pixel.
+    ARG = 0x05, ///< -- p: push the effect parameter whose index follows the instruction.
+    DUP = 0x06, ///< a -- a a
+    SWAP = 0x07, ///< a b -- b a
+    DROP = 0x08, ///< a --
+    OVER = 0x09, ///< a b -- a b a
+    ADD = 0x0A, ///< a b -- a + b
+    SUB = 0x0B, ///< a b -- a - b
+    MUL = 0x0C, ///< a b -- the low byte of a * b
+    SCALE = 0x0D, ///< a b -- a scaled by b / 256, see scale8()
+    AND = 0x0E, ///< a b -- a & b
+    OR = 0x0F, ///< a b -- a | b
+    XOR = 0x10, ///< a b -- a ^ b
+    MIN = 0x11, ///< a b -- the smaller of a and b
+    MAX = 0x12, ///< a b -- the larger of a and b
+    LT = 0x13, ///< a b -- 255 if a < b, 0 otherwise
+    EQ = 0x14, ///< a b -- 255 if a == b, 0 otherwise
+    QADD = 0x15, ///< a b -- a + b, saturating at 255
+    QSUB = 0x16, ///< a b -- a - b, saturating at 0
+    SHL = 0x17, ///< a -- a shifted left by the number of bits (0 - 7) following the instruction
+    SHR = 0x18, ///< a -- a shifted right by the number of bits (0 - 7) following the instruction
+    NOT = 0x19, ///< a -- 255 - a
+    SIN = 0x1A, ///< a -- sin8(a)
+    COS = 0x1B, ///< a -- cos8(a)
+    NOISE = 0x1C, ///< x y -- value noise at x, y, 16 units per lattice cell, see noise8()
+    JZ = 0x1D, ///< a -- skip the number of bytes of code following the instruction if a is 0
+    JMP = 0x1E, ///< -- skip the number of bytes of code following the instruction
+    RGB = 0x1F, ///< r g b -- output the color r, g, b
+    HUE = 0x20, ///< h -- output the color at h on the color wheel, see color_t::wheel()
+    PAL = 0x21, ///< v -- output the color at v of the palette, blending between its colors and wrapping around
+};
+
+constexpr uint8_t SHADER_OP_COUNT = 0x22; ///< The number of instructions.
+
+/**
+ * @brief Write a part of the program into the EEPROM.
+ *
+ * The program is written in chunks like the keyframe animation. Once the chunk that ends the program
+ * has been written, the program is validated.
+ *
+ * @param offset The offset of the chunk from the start of the program.
+ * @param data The bytes of the chunk.
+ * @param count The number of bytes, at most STORAGE_CHUNK_SIZE.
+ * @return INVALID_ARGUMENT if the chunk exceeds the EEPROM region or completes an invalid program, OK otherwise.
+ */
+state_t writeShader(uint16_t offset, const uint8_t *data, uint8_t count);
+
+/**
+ * @brief Load the program from the EEPROM.
+ *
+ * @param leds The LED strip.
+ * @param params The parameters of the effect.
+ * @param scratch The scratch memory of the effect.
+ */
+void shaderInit(Adafruit_NeoPixel &leds, const uint8_t *params, uint8_t *scratch);
+
+/**
+ * @brief Run the program for every pixel.
+ *
+ * The program has been validated when it was loaded, so the interpreter needs no checks of the stack or the jumps.
+ *
+ * @param leds The LED strip to render onto.
+ * @param t The time in milliseconds.
+ * @param params The parameters of the effect.
+ * @param scratch The scratch memory of the effect.
+ * @return False if there is no valid program, true otherwise.
+ */
+bool shaderRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *params, uint8_t *scratch);
+
+#endif //SHADER_H
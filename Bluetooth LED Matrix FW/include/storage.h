@@ -0,0 +1,62 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include "config.h"
+
+/*
+ * EEPROM layout:
+ *
+ * Every module that persists data owns a fixed region of the EEPROM, so the regions never overlap and
+ * the firmware can be updated without losing the data of the other modules.
+ * Erased cells read as 0xFF, so every region must treat all bytes being 0xFF as empty.
+ */
+
+constexpr uint16_t EEPROM_SIZE = E2END + 1; ///< The size of the EEPROM of the MCU.
+
+constexpr uint16_t ANIMATION_ADDR = 0; ///< The address of the keyframe animation.
+constexpr uint16_t ANIMATION_SIZE = 256; ///< The maximum size of the keyframe animation.
+
+constexpr uint16_t SHADER_ADDR = ANIMATION_ADDR + ANIMATION_SIZE; ///< The address of the shader program.
+constexpr uint16_t SHADER_SIZE = 128; ///< The maximum size of the shader program.
+
+constexpr uint16_t STATE_ADDR = SHADER_ADDR + SHADER_SIZE; ///< The address of the ring of persisted states.
+constexpr uint16_t STATE_SIZE = 140; ///< The size of the ring of persisted states.
+
+constexpr uint16_t FRAME_ADDR = STATE_ADDR + STATE_SIZE; ///< The address of the persisted frame.
+/// The size of the persisted frame, a copy of the pixel buffer of the LED strip.
+constexpr uint16_t FRAME_SIZE = Matrix::LED_COUNT * Matrix::BYTES_PER_PIXEL;
+
+constexpr uint16_t SCENE_ADDR = FRAME_ADDR + FRAME_SIZE; ///< The address of the scene slots.
+/// The size of a scene slot, a palette of 16 colors, a palette index per LED and the header, see scenes.h.
+constexpr uint16_t SCENE_SIZE = 3 + 16 * 3 + (Matrix::LED_COUNT + 1) / 2;
+/// The number of scene slots, all the EEPROM after the other regions holds.
+constexpr uint8_t SCENE_SLOTS = (EEPROM_SIZE - SCENE_ADDR) / SCENE_SIZE;
+
+constexpr uint16_t STORAGE_END = SCENE_ADDR + SCENE_SLOTS * SCENE_SIZE; ///< The end of the last region.
+
+/// The maximum number of bytes written by a single command, as the EEPROM takes about 3.4 ms per byte,
+/// which is longer than the receive buffer of the Bluetooth serial lasts.
+constexpr uint8_t STORAGE_CHUNK_SIZE = 32;
+
+static_assert(STORAGE_END <= EEPROM_SIZE, "the regions exceed the EEPROM of the MCU");
+
+/**
+ * @brief Get a pointer into the EEPROM address space, as taken by the functions of avr/eeprom.h.
+ *
+ * @param addr The address in the EEPROM.
+ * @return The pointer to the address.
+ */
+inline uint8_t *eepromPtr(uint16_t addr) { return reinterpret_cast<uint8_t *>(addr); }
+
+/**
+ * @brief Add a byte to a checksum. Rotating the sum before adding the byte makes it depend on the order of the bytes.
+ *
+ * @param sum The checksum of the bytes before.
+ * @param b The byte.
+ * @return The checksum including the byte.
+ */
+inline uint16_t checksumAdd(uint16_t sum, uint8_t b) { return (uint16_t) ((sum << 1 | sum >> 15) + b); }
+
+#endif //STORAGE_H
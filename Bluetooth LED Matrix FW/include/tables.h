@@ -0,0 +1,72 @@
+#ifndef TABLES_H
+#define TABLES_H
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+extern const uint8_t SIN8_TABLE[256] PROGMEM; ///< One period of a sine wave scaled to the range [1, 255].
+extern const uint8_t NOISE_PERMUTATION[256] PROGMEM; ///< A permutation of [0, 255] used to hash the lattice points of noise8().
+
+/**
+ * @brief Look up the sine of an angle.
+ *
+ * @param x The angle, where 256 is a full period.
+ * @return The sine, scaled from [-1, 1] to [1, 255].
+ */
+inline uint8_t sin8(uint8_t x) { return pgm_read_byte(&SIN8_TABLE[x]); }
+
+/**
+ * @brief Look up the cosine of an angle.
+ *
+ * @param x The angle, where 256 is a full period.
+ * @return The cosine, scaled from [-1, 1] to [1, 255].
+ */
+inline uint8_t cos8(uint8_t x) { return sin8((uint8_t) (x + 64)); }
+
+/**
+ * @brief Scale a value by a fraction of 256, e.g. to apply a brightness.
+ *
+ * @param value The value to scale.
+ * @param scale The scale, where 255 keeps the value.
+ * @return The scaled value.
+ */
+inline uint8_t scale8(uint8_t value, uint8_t scale) { return (uint8_t) (((uint16_t) value * (scale + 1)) >> 8); }
+
+/**
+ * @brief Linearly interpolate between two values.
+ *
+ * @param a The value returned for t = 0.
+ * @param b The value approached for t = 255.
+ * @param t The interpolation position.
+ * @return The interpolated value.
+ */
+inline uint8_t lerp8(uint8_t a, uint8_t b, uint8_t t) {
+    // the difference is scaled unsigned, as a signed product could overflow the 16 bit int of the AVR
+    return b >= a ? (uint8_t) (a + (((uint16_t) (b - a) * t) >> 8)) : (uint8_t) (a - (((uint16_t) (a - b) * t) >> 8));
+}
+
+/**
+ * @brief Smooth a linear interpolation position with the cubic smoothstep curve 3t^2 - 2t^3.
+ *
+ * @param t The linear interpolation position.
+ * @return The smoothed interpolation position.
+ */
+inline uint8_t ease8(uint8_t t) {
+    uint16_t t2 = ((uint16_t) t * t) >> 8;
+    uint16_t s = 3 * t2 - ((t2 * t) >> 7); // 2 * t2 * t would overflow 16 bits
+    return s > 255 ? 255 : (uint8_t) s;
+}
+
+/**
+ * @brief Evaluate two-dimensional value noise.
+ *
+ * The lattice points are hashed with NOISE_PERMUTATION and interpolated with ease8(),
+ * so the noise changes smoothly between neighboring coordinates.
+ *
+ * @param x The x coordinate as 8.8 fixed point number; a lattice cell is 256 units wide.
+ * @param y The y coordinate as 8.8 fixed point number.
+ * @return The noise value in the range [0, 255].
+ */
+uint8_t noise8(uint16_t x, uint16_t y);
+
+#endif //TABLES_H
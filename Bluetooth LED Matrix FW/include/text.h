@@ -0,0 +1,48 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <Arduino.h>
+#include "Adafruit_NeoPixel.h"
+
+/*
+ * TEXT
+ *      params: r, g, b (default 255, 255, 255), step time in 10 ms (default 8)
+ *      the text set by setText() scrolls from right to left through the vertically centered rows, one column per step
+ *      once it has scrolled out of the matrix, it starts again
+ */
+
+constexpr uint8_t TEXT_MAX_LENGTH = 32; ///< The maximum number of characters of the scrolling text.
+
+/**
+ * @brief Set the text that the TEXT effect scrolls.
+ *
+ * @param chars The characters of the text.
+ * @param length The number of characters, at most TEXT_MAX_LENGTH.
+ * @return False if the text is too long, true otherwise.
+ */
+bool setText(const char *chars, uint8_t length);
+
+/**
+ * @brief Start scrolling the text from the right edge of the matrix.
+ *
+ * @param leds The LED strip.
+ * @param params The parameters of the effect.
+ * @param scratch The scratch memory of the effect.
+ */
+void textInit(Adafruit_NeoPixel &leds, const uint8_t *params, uint8_t *scratch);
+
+/**
+ * @brief Scroll the text by one column if the step time has passed.
+ *
+ * The content of the matrix is shifted in place and only the column entering at the right edge is rasterized,
+ * so the text never needs to be rendered as a whole.
+ *
+ * @param leds The LED strip to render onto.
+ * @param t The time in milliseconds.
+ * @param params The parameters of the effect.
+ * @param scratch The scratch memory of the effect.
+ * @return True if the text has been scrolled.
+ */
+bool textRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *params, uint8_t *scratch);
+
+#endif //TEXT_H
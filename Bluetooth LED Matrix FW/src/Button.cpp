@@ -1,38 +1,63 @@
 #include "Button.hpp"
+#include <util/atomic.h>
 
-Button::state_t Button::read() const {
-    state_t returnValue = state_t::RELEASED;
-    static uint32_t read = millis();
-    static auto wasPressed = false;
-    static bool mayReturn = true;
-    auto state = !digitalRead(pin);
+Button *Button::first = nullptr;
+uint8_t Button::count = 0;
+SpscRing<Button::event_t, Button::EVENT_QUEUE_SIZE> Button::events;
 
-    if (millis() - read > 200) {
-        read = millis();
+void Button::begin() {
+    pinMode(pin, INPUT_PULLUP);
+    input = portInputRegister(digitalPinToPort(pin));
+    mask = digitalPinToBitMask(pin);
+    number = count++;
+    next = first;
+    first = this;
+}
 
-        if (wasPressed) {
-            if (state) {
-                returnValue = state_t::PRESSED_CONTINUOUSLY;
-            } else {
-                returnValue = state_t::PRESSED;
-            }
-        }
+void Button::setTiming(uint8_t debounceTime, uint16_t longPressTime, uint16_t doubleClickTime, uint16_t repeatTime) {
+    // the timing is read by sample() from the interrupt of the tick
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        this->debounceTime = debounceTime;
+        this->longPressTime = longPressTime;
+        this->doubleClickTime = doubleClickTime;
+        this->repeatTime = repeatTime;
+    }
+}
 
-        if (state && !wasPressed) {
-            wasPressed = true;
-        } else if (!state) {
-            wasPressed = false;
-        }
+void Button::sample() {
+    for (Button *button = first; button; button = button->next) button->update();
+}
 
-        if (mayReturn && returnValue != state_t::RELEASED) {
-            mayReturn = false;
-            return returnValue;
-        }
+void Button::update() {
+    bool level = !(*input & mask); // the pin is pulled low while the button is pressed
 
-        if (returnValue == state_t::RELEASED) {
-            mayReturn = true;
+    if (level == pressed) {
+        bounce = 0;
+    } else if (++bounce >= debounceTime) {
+        bounce = 0;
+        pressed = level;
+        if (pressed) {
+            raise(event_kind_t::PRESS);
+            doubled = released < doubleClickTime;
+            if (doubled) raise(event_kind_t::DOUBLE);
+            held = 0;
+        } else {
+            raise(event_kind_t::RELEASE);
+            // the press after a double click starts a new click
+            released = doubled ? UINT16_MAX : 0;
         }
+        return;
     }
 
-    return state_t::RELEASED;
+    if (!pressed) {
+        if (released != UINT16_MAX) released++;
+    } else if (held < longPressTime) {
+        if (++held == longPressTime) {
+            raise(event_kind_t::LONG);
+            repeat = repeatTime;
+        }
+    } else if (repeatTime && --repeat == 0) {
+        raise(event_kind_t::REPEAT);
+        repeat = repeatTime;
+    }
 }
@@ -0,0 +1,204 @@
+#include "animation.h"
+#include "color.h"
+#include "config.h"
+#include "effects.h"
+#include "storage.h"
+
+using L = MatrixLayout;
+
+constexpr uint16_t PACKED_SIZE = (Matrix::LED_COUNT + 1) / 2; ///< The size of the palette indices of all LEDs.
+constexpr uint8_t HEADER_SIZE = 4; ///< The size of the header of the animation.
+constexpr uint8_t FLAG_LOOP = 0x01; ///< The animation fades back to its first keyframe after the last one.
+
+/**
+ * @struct animation_t
+ * @brief The state of the keyframe animation, stored in the scratch memory of the effects.
+ */
+struct animation_t {
+    color_t palette[ANIMATION_MAX_COLORS]; ///< The colors of the animation.
+    uint8_t from[PACKED_SIZE]; ///< The palette indices of the previous keyframe, two LEDs per byte.
+    uint8_t to[PACKED_SIZE]; ///< The palette indices of the keyframe faded to, two LEDs per byte.
+    uint16_t first; ///< The offset of the first keyframe.
+    uint16_t next; ///< The offset of the keyframe after the one faded to.
+    uint16_t fadeTime; ///< The time in milliseconds the fade to the keyframe takes.
+    uint32_t start; ///< The time the fade to the keyframe has started in milliseconds.
+    uint8_t keyframe; ///< The index of the keyframe faded to.
+    uint8_t count; ///< The number of keyframes.
+    bool done; ///< True once the last frame has been rendered.
+};
+
+static_assert(sizeof(animation_t) <= EFFECT_SCRATCH_SIZE, "the state must fit into the scratch memory of the effects");
+static_assert(HEADER_SIZE + ANIMATION_MAX_COLORS * 3 + 3 + PACKED_SIZE <= ANIMATION_SIZE,
+              "the EEPROM region must hold at least a full keyframe with a full palette");
+
+static bool valid = false; ///< True if the animation in the EEPROM has been validated.
+
+
+/**
+ * @brief Read a byte of the animation from the EEPROM.
+ *
+ * @param offset The offset from the start of the animation.
+ * @return The byte.
+ */
+static uint8_t readByte(uint16_t offset) { return eeprom_read_byte(eepromPtr(ANIMATION_ADDR + offset)); }
+
+/**
+ * @brief Read a big-endian 16 bit value of the animation from the EEPROM.
+ *
+ * @param offset The offset of the high byte from the start of the animation.
+ * @return The 16 bit value.
+ */
+static uint16_t read16(uint16_t offset) { return (uint16_t) readByte(offset) << 8 | readByte(offset + 1); }
+
+/**
+ * @brief Get the palette index of a LED from packed palette indices.
+ *
+ * @param packed The palette indices, two LEDs per byte.
+ * @param n The logical number of the LED.
+ * @return The palette index.
+ */
+static uint8_t getIndex(const uint8_t *packed, uint16_t n) { return n & 1 ? packed[n >> 1] & 0x0F : packed[n >> 1] >> 4; }
+
+/**
+ * @brief Set the palette index of a LED in packed palette indices.
+ *
+ * @param packed The palette indices, two LEDs per byte.
+ * @param n The logical number of the LED.
+ * @param index The palette index.
+ */
+static void setIndex(uint8_t *packed, uint16_t n, uint8_t index) {
+    uint8_t &b = packed[n >> 1];
+    b = n & 1 ? (b & 0xF0) | (index & 0x0F) : (b & 0x0F) | (uint8_t) (index << 4);
+}
+
+/**
+ * @brief Check that the animation in the EEPROM is complete and only refers to existing colors and LEDs.
+ *
+ * @return True if the animation can be played.
+ */
+static bool validate() {
+    uint16_t length = read16(0);
+    uint8_t colors = readByte(2);
+    uint8_t count = readByte(3);
+    if (length < HEADER_SIZE || length > ANIMATION_SIZE) return false;
+    if (colors == 0 || colors > ANIMATION_MAX_COLORS || count == 0) return false;
+
+    uint16_t pos = HEADER_SIZE + colors * 3;
+    for (uint8_t k = 0; k < count; k++) {
+        if (pos + 3 > length) return false;
+        auto type = static_cast<keyframe_t>(readByte(pos + 2));
+        pos += 3;
+        if (type == keyframe_t::FULL) {
+            if (pos + PACKED_SIZE > length) return false;
+            for (uint16_t i = 0; i < PACKED_SIZE; i++, pos++) {
+                uint8_t b = readByte(pos);
+                if (b >> 4 >= colors || (b & 0x0F) >= colors) return false;
+            }
+        } else if (type == keyframe_t::SPARSE) {
+            if (pos + 1 > length) return false;
+            uint8_t n = readByte(pos++);
+            if (pos + n * 3 > length) return false;
+            for (uint8_t i = 0; i < n; i++, pos += 3) {
+                if (read16(pos) >= Matrix::LED_COUNT || readByte(pos + 2) >= colors) return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return pos == length;
+}
+
+/**
+ * @brief Read a keyframe from the EEPROM and apply it to the palette indices faded to.
+ *
+ * @param anim The state of the animation.
+ * @param pos The offset of the keyframe.
+ * @return The offset of the keyframe following it.
+ */
+static uint16_t readKeyframe(animation_t &anim, uint16_t pos) {
+    anim.fadeTime = read16(pos);
+    auto type = static_cast<keyframe_t>(readByte(pos + 2));
+    pos += 3;
+    if (type == keyframe_t::FULL) {
+        eeprom_read_block(anim.to, eepromPtr(ANIMATION_ADDR + pos), PACKED_SIZE);
+        return pos + PACKED_SIZE;
+    }
+    uint8_t n = readByte(pos++);
+    for (uint8_t i = 0; i < n; i++, pos += 3) {
+        uint16_t led = read16(pos);
+        if (led < Matrix::LED_COUNT) setIndex(anim.to, led, readByte(pos + 2));
+    }
+    return pos;
+}
+
+/**
+ * @brief Start the fade to the keyframe following the one that has been reached.
+ *
+ * The first keyframe is applied to all LEDs showing the first color, both when the animation starts and
+ * when it loops, so sparse first keyframes look the same every time.
+ *
+ * @param anim The state of the animation.
+ * @param loop True if the animation continues with the first keyframe after the last one.
+ */
+static void advance(animation_t &anim, bool loop) {
+    memcpy(anim.from, anim.to, PACKED_SIZE);
+    anim.start += anim.fadeTime; // keep the keyframes on schedule even if a frame is rendered late
+    if (++anim.keyframe >= anim.count) {
+        if (!loop) {
+            anim.done = true;
+            return;
+        }
+        anim.keyframe = 0;
+        anim.next = anim.first;
+        memset(anim.to, 0, PACKED_SIZE);
+    }
+    anim.next = readKeyframe(anim, anim.next);
+}
+
+
+state_t writeAnimation(uint16_t offset, const uint8_t *data, uint8_t count) {
+    if (count > STORAGE_CHUNK_SIZE || (uint32_t) offset + count > ANIMATION_SIZE) return state_t::INVALID_ARGUMENT;
+    valid = false;
+    eeprom_update_block(data, eepromPtr(ANIMATION_ADDR + offset), count);
+    if ((uint32_t) offset + count < read16(0)) return state_t::OK; // more chunks follow
+    valid = validate();
+    return valid ? state_t::OK : state_t::INVALID_ARGUMENT;
+}
+
+void animationInit(Adafruit_NeoPixel &, const uint8_t *, uint8_t *scratch) {
+    auto &anim = *reinterpret_cast<animation_t *>(scratch);
+    anim.done = false;
+    valid = validate();
+    if (!valid) return;
+
+    uint8_t colors = readByte(2);
+    eeprom_read_block(anim.palette, eepromPtr(ANIMATION_ADDR + HEADER_SIZE), colors * sizeof(color_t));
+    anim.count = readByte(3);
+    anim.first = HEADER_SIZE + colors * 3;
+    anim.keyframe = 0;
+    memset(anim.to, 0, PACKED_SIZE);
+    anim.next = readKeyframe(anim, anim.first);
+    memcpy(anim.from, anim.to, PACKED_SIZE);
+    anim.fadeTime = 0; // the first keyframe is shown at once
+    anim.start = millis();
+}
+
+bool animationRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *params, uint8_t *scratch) {
+    auto &anim = *reinterpret_cast<animation_t *>(scratch);
+    if (anim.done) return false;
+    if (!valid) {
+        // there is no animation to play, or it is being replaced
+        leds.clear();
+        anim.done = true;
+        return true;
+    }
+
+    uint32_t elapsed = t - anim.start;
+    uint8_t progress = elapsed >= anim.fadeTime ? 255 : (uint8_t) (elapsed * 255 / anim.fadeTime);
+    for (uint16_t n = 0; n < Matrix::LED_COUNT; n++) {
+        color_t c = color_t::lerp(anim.palette[getIndex(anim.from, n)], anim.palette[getIndex(anim.to, n)], progress);
+        leds.setPixelColor(L::index(n), c.r, c.g, c.b);
+    }
+    if (progress == 255) advance(anim, params[0] & FLAG_LOOP);
+    return true;
+}
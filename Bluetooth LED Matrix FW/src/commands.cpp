@@ -0,0 +1,1272 @@
+#include "commands.h"
+#include "uart_serial.h"
+#include "config.h"
+#include "device.h"
+#include "effects.h"
+#include "animation.h"
+#include "shader.h"
+#include "output.h"
+#include "scheduler.h"
+#include "scenes.h"
+#include "params.h"
+
+static_assert(5 + Matrix::LED_COUNT * 5 <= INT16_MAX, "the longest command must be countable with an int16_t");
+static_assert(CMD_BUFFER_SIZE >= 2 + EFFECT_MAX_PARAMS, "the command buffer must hold the parameters of an effect");
+static_assert(CMD_BUFFER_SIZE >= 3 + STORAGE_CHUNK_SIZE, "the command buffer must hold a chunk written into the EEPROM");
+
+
+static bool dirty = false; ///< True if the pixels of the LED strip have been changed by the current command.
+static bool receiving = false; ///< True while a command is being received.
+static uint16_t showTime = 0; ///< The time in microseconds the last call of showFrame() took, 0 if not measured yet.
+
+static uint16_t respondFirst = 0; ///< The logical number of the first LED streamed by respondSlice().
+static uint16_t respondNext = 0; ///< The logical number of the next LED streamed by respondSlice().
+static uint16_t respondEnd = 0; ///< The logical number after the last LED streamed by respondSlice().
+static bool respondNumbered = false; ///< True if each streamed color is preceded by the number of the LED.
+
+/// The number of LEDs streamed per call of btReceive(), about 1 ms each on the wire.
+constexpr uint8_t RESPOND_SLICE_LEDS = 4;
+
+/// Bit n is set if command n is handled by btReceive(), reported by GET_INFO.
+constexpr uint32_t SUPPORTED_COMMANDS = 1ul << (uint8_t) cmd_t::GET_LEDS | 1ul << (uint8_t) cmd_t::SET_LEDS |
+                                        1ul << (uint8_t) cmd_t::SET_LEDS_ALL | 1ul << (uint8_t) cmd_t::GRADIENT |
+                                        1ul << (uint8_t) cmd_t::PATTERN | 1ul << (uint8_t) cmd_t::SHIFT |
+                                        1ul << (uint8_t) cmd_t::INSERT_COLUMN | 1ul << (uint8_t) cmd_t::INSERT_ROW |
+                                        1ul << (uint8_t) cmd_t::SET_RANGE | 1ul << (uint8_t) cmd_t::FILL_RANGE |
+                                        1ul << (uint8_t) cmd_t::GET_RANGE | 1ul << (uint8_t) cmd_t::SET_LEDS_16 |
+                                        1ul << (uint8_t) cmd_t::GET_INFO | 1ul << (uint8_t) cmd_t::SET_EFFECT |
+                                        1ul << (uint8_t) cmd_t::SHOW_TEXT | 1ul << (uint8_t) cmd_t::WRITE_ANIMATION |
+                                        1ul << (uint8_t) cmd_t::WRITE_SHADER | 1ul << (uint8_t) cmd_t::SET_OVERLAY |
+                                        1ul << (uint8_t) cmd_t::CLEAR_OVERLAY | 1ul << (uint8_t) cmd_t::SET_TRANSITION |
+                                        1ul << (uint8_t) cmd_t::SET_POWER_LIMIT | 1ul << (uint8_t) cmd_t::SET_BRIGHTNESS |
+                                        1ul << (uint8_t) cmd_t::GET_TASKS | 1ul << (uint8_t) cmd_t::STORE_SCENE |
+                                        1ul << (uint8_t) cmd_t::RECALL_SCENE | 1ul << (uint8_t) cmd_t::SYNC_CLOCK |
+                                        1ul << (uint8_t) cmd_t::STAGE | 1ul << (uint8_t) cmd_t::COMMIT_AT |
+                                        1ul << (uint8_t) cmd_t::GET_PARAM | 1ul << (uint8_t) cmd_t::SET_PARAM;
+
+/// The time in microseconds the data of a frame takes on the wire (1.25 or 2.5 microseconds per bit at 800 or 400 kHz).
+constexpr uint32_t FRAME_WIRE_TIME = (uint32_t) Matrix::LED_COUNT * Matrix::BYTES_PER_PIXEL * 8 * 5
+                                     / ((Matrix::LEDS_TYPE & NEO_KHZ400) ? 2 : 4);
+
+
+void btRespond(cmd_t cmd, state_t state, const uint8_t *data, size_t length);
+void btRespondLeds(uint16_t first, uint16_t count, bool numbered);
+void respondSlice();
+
+
+bool cmdNone(state_t &state, cmd_t &cmd, uint8_t data);
+bool cmdSetLeds(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdSetLedsAll(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdGradient(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdPattern(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdShift(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdInsertColumn(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdInsertRow(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdSetRange(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdFillRange(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdGetRange(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdSetLeds16(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdSetEffect(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdShowText(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdWriteAnimation(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdWriteShader(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdSetOverlay(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdSetTransition(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdSetPowerLimit(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdSetBrightness(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdStoreScene(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdRecallScene(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdSyncClock(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdCommitAt(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdGetParam(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+bool cmdSetParam(int16_t count, state_t &state, uint8_t *buffer, uint8_t data);
+
+
+/**
+ * @brief Read a big-endian 16 bit value from a buffer.
+ *
+ * @param data The buffer holding the high byte followed by the low byte.
+ * @return The 16 bit value.
+ */
+static uint16_t be16(const uint8_t *data) { return (uint16_t) data[0] << 8 | data[1]; }
+
+/**
+ * @brief Read a big-endian 32 bit value from a buffer.
+ *
+ * @param data The buffer holding the highest byte first.
+ * @return The 32 bit value.
+ */
+static uint32_t be32(const uint8_t *data) { return (uint32_t) be16(data) << 16 | be16(data + 2); }
+
+/**
+ * @brief Set the color of a LED by its logical number and mark the LED strip as changed.
+ *
+ * @param n The logical number of the LED.
+ * @param r The red component of the color.
+ * @param g The green component of the color.
+ * @param b The blue component of the color.
+ */
+static void setLed(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+    leds.setPixelColor(MatrixLayout::index(n), r, g, b);
+    mode = mode_t::BT;
+    dirty = true;
+}
+
+/**
+ * @brief Print a received byte that does not belong to the current command.
+ *
+ * @param data The byte received.
+ * @return Always false, as the command is not complete before no more data is received.
+ */
+static bool consume(uint8_t data) {
+    uart_print("INFO: CONSUMING EXTRA DATA: ");
+    uart_println(data, HEX);
+    return false;
+}
+
+/**
+ * @brief Receive a chunk of data that is written into the EEPROM: offset (2), count, [byte] * count.
+ *
+ * If the chunk is too large, the state variable is set to INVALID_ARGUMENT and the rest of the data is consumed.
+ * Once all bytes have been received, the chunk is written, and the state variable is set to the result.
+ * The sender waits for the response before sending the next chunk, so no data arrives while the EEPROM is written.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution.
+ * @param buffer The data array where the chunk will be stored, of size 3 + STORAGE_CHUNK_SIZE.
+ * @param data The data byte received.
+ * @param write The function writing the chunk into the EEPROM region of its module.
+ * @return True if the command is complete, false if more data is expected.
+ */
+static bool writeChunk(int16_t count, state_t &state, uint8_t *buffer, uint8_t data,
+                       state_t (*write)(uint16_t, const uint8_t *, uint8_t)) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    buffer[count] = data;
+    if (count == 2 && data > STORAGE_CHUNK_SIZE) {
+        state = state_t::INVALID_ARGUMENT;
+        return false;
+    }
+    if (count < 2 || count != 2 + buffer[2]) return false;
+
+    state = write(be16(buffer), buffer + 3, buffer[2]);
+    return true;
+}
+
+/**
+ * @brief Show the composed frame and measure how long it takes.
+ *
+ * The LED strip disables interrupts while sending a frame, so micros() misses all but one timer overflow meanwhile.
+ * The overflows missed are restored from the known time the frame takes on the wire.
+ */
+static void show() {
+    if (framesStaged()) return; // shown by the commit
+    while (!leds.canShow()); // exclude the latch time of the previous frame from the measurement
+    uint32_t start = micros();
+    showFrame();
+    uint32_t time = micros() - start;
+    if (FRAME_WIRE_TIME > time) time += (FRAME_WIRE_TIME - time + 512) / 1024 * 1024;
+    showTime = (uint16_t) min(time, (uint32_t) UINT16_MAX);
+}
+
+
+void btReceive() {
+    static int16_t count = -1; // -1 = cmd not received, 0 = first data byte, >0 = data index
+    static cmd_t cmd = cmd_t::NONE;
+    static state_t state = state_t::INVALID_DATA_LENGTH;
+    static uint8_t buffer[CMD_BUFFER_SIZE];
+    static uint32_t lastReceive = 0;
+
+    if (btResponding()) {
+        respondSlice();
+        return;
+    }
+
+    bool complete = false;
+    while (!complete && btSer.available()) {
+        auto data = btSer.read();
+        if (data < 0) {
+            uart_println("ERROR: INVALID DATA");
+            return;
+        }
+        lastReceive = millis();
+
+        if (count < 0 || cmd == cmd_t::NONE) {
+            complete = cmdNone(state, cmd, (uint8_t) data);
+            count++;
+            continue;
+        }
+        switch (cmd) {
+            case cmd_t::NONE:
+            case cmd_t::GET_LEDS:
+            case cmd_t::GET_INFO:
+            case cmd_t::CLEAR_OVERLAY:
+            case cmd_t::GET_TASKS:
+            case cmd_t::STAGE:
+                complete = consume((uint8_t) data);
+                break;
+            case cmd_t::SET_LEDS:
+                complete = cmdSetLeds(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SET_LEDS_ALL:
+                complete = cmdSetLedsAll(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::GRADIENT:
+                complete = cmdGradient(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::PATTERN:
+                complete = cmdPattern(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SHIFT:
+                complete = cmdShift(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::INSERT_COLUMN:
+                complete = cmdInsertColumn(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::INSERT_ROW:
+                complete = cmdInsertRow(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SET_RANGE:
+                complete = cmdSetRange(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::FILL_RANGE:
+                complete = cmdFillRange(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::GET_RANGE:
+                complete = cmdGetRange(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SET_LEDS_16:
+                complete = cmdSetLeds16(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SET_EFFECT:
+                complete = cmdSetEffect(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SHOW_TEXT:
+                complete = cmdShowText(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::WRITE_ANIMATION:
+                complete = cmdWriteAnimation(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::WRITE_SHADER:
+                complete = cmdWriteShader(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SET_OVERLAY:
+                complete = cmdSetOverlay(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SET_TRANSITION:
+                complete = cmdSetTransition(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SET_POWER_LIMIT:
+                complete = cmdSetPowerLimit(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SET_BRIGHTNESS:
+                complete = cmdSetBrightness(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::STORE_SCENE:
+                complete = cmdStoreScene(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::RECALL_SCENE:
+                complete = cmdRecallScene(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SYNC_CLOCK:
+                complete = cmdSyncClock(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::COMMIT_AT:
+                complete = cmdCommitAt(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::GET_PARAM:
+                complete = cmdGetParam(count, state, buffer, (uint8_t) data);
+                break;
+            case cmd_t::SET_PARAM:
+                complete = cmdSetParam(count, state, buffer, (uint8_t) data);
+                break;
+        }
+        count++;
+    }
+
+    // wait for the rest of the command unless it is complete or the sender has stopped sending
+    if (!complete && (count < 0 || millis() - lastReceive < BT_IDLE_TIMEOUT)) {
+        receiving = count >= 0;
+        return;
+    }
+
+    uart_print("READ ");
+    uart_print(count + 1);
+    uart_println(" BYTES");
+
+    if (dirty) {
+        show();
+        dirty = false;
+    }
+    commandSync();
+
+    if (state == state_t::OK) {
+        switch (cmd) {
+            case cmd_t::NONE:
+                uart_println("should not happen");
+                break;
+            case cmd_t::GET_LEDS:
+                btRespond(cmd, state, nullptr, 0);
+                btRespondLeds(0, Matrix::LED_COUNT < 256 ? Matrix::LED_COUNT : 256, true);
+                break;
+            case cmd_t::GET_RANGE:
+                btRespond(cmd, state, buffer, 4);
+                btRespondLeds(be16(buffer), be16(buffer + 2), false);
+                break;
+            case cmd_t::GET_INFO: {
+                if (showTime == 0) show();
+                uint8_t info[] = {
+                        PROTOCOL_VERSION,
+                        MatrixLayout::WIDTH,
+                        MatrixLayout::HEIGHT,
+                        (uint8_t) (Matrix::LED_COUNT >> 8), (uint8_t) Matrix::LED_COUNT,
+                        _SS_MAX_RX_BUFF - 1, // the ring buffer of SoftwareSerial holds one byte less than its size
+                        BT_IDLE_TIMEOUT,
+                        (uint8_t) (SUPPORTED_COMMANDS >> 24), (uint8_t) (SUPPORTED_COMMANDS >> 16),
+                        (uint8_t) (SUPPORTED_COMMANDS >> 8), (uint8_t) SUPPORTED_COMMANDS,
+                        (uint8_t) (showTime >> 8), (uint8_t) showTime,
+                };
+                btRespond(cmd, state, info, sizeof(info));
+                break;
+            }
+            case cmd_t::GET_TASKS: {
+                uint8_t stats[3 + SCHEDULER_MAX_TASKS * 10 + 10];
+                uint16_t frames = shownFrames();
+                stats[0] = (uint8_t) (frames >> 8);
+                stats[1] = (uint8_t) frames;
+                stats[2] = taskCount();
+                uint8_t *p = stats + 3;
+                for (uint8_t i = 0; i < taskCount(); i++, p += 10) {
+                    const task_stats_t &t = taskStats(i);
+                    p[0] = (uint8_t) (t.runs >> 8);
+                    p[1] = (uint8_t) t.runs;
+                    p[2] = (uint8_t) (t.late >> 8);
+                    p[3] = (uint8_t) t.late;
+                    p[4] = (uint8_t) (t.maxTime >> 8);
+                    p[5] = (uint8_t) t.maxTime;
+                    p[6] = (uint8_t) (t.time >> 24);
+                    p[7] = (uint8_t) (t.time >> 16);
+                    p[8] = (uint8_t) (t.time >> 8);
+                    p[9] = (uint8_t) t.time;
+                }
+                uint32_t asleep = idleTime();
+                uint16_t wake = maxWakeLatency();
+                *p++ = (uint8_t) (asleep >> 24);
+                *p++ = (uint8_t) (asleep >> 16);
+                *p++ = (uint8_t) (asleep >> 8);
+                *p++ = (uint8_t) asleep;
+                *p++ = (uint8_t) (wake >> 8);
+                *p++ = (uint8_t) wake;
+                uint16_t pixel = firstFrameTime();
+                uint16_t command = firstCommandTime();
+                *p++ = (uint8_t) (pixel >> 8);
+                *p++ = (uint8_t) pixel;
+                *p++ = (uint8_t) (command >> 8);
+                *p++ = (uint8_t) command;
+                resetTaskStats();
+                btRespond(cmd, state, stats, p - stats);
+                break;
+            }
+            case cmd_t::SET_LEDS:
+            case cmd_t::SET_LEDS_ALL:
+            case cmd_t::GRADIENT:
+            case cmd_t::PATTERN:
+            case cmd_t::SHIFT:
+            case cmd_t::INSERT_COLUMN:
+            case cmd_t::INSERT_ROW:
+            case cmd_t::SET_RANGE:
+            case cmd_t::FILL_RANGE:
+            case cmd_t::SET_LEDS_16:
+            case cmd_t::SET_EFFECT:
+            case cmd_t::SHOW_TEXT:
+            case cmd_t::WRITE_ANIMATION:
+            case cmd_t::WRITE_SHADER:
+            case cmd_t::SET_OVERLAY:
+            case cmd_t::CLEAR_OVERLAY:
+            case cmd_t::SET_TRANSITION:
+            case cmd_t::SET_POWER_LIMIT:
+            case cmd_t::SET_BRIGHTNESS:
+            case cmd_t::RECALL_SCENE:
+            case cmd_t::STAGE:
+            case cmd_t::COMMIT_AT:
+            case cmd_t::SET_PARAM:
+                btRespond(cmd, state, nullptr, 0);
+                break;
+            case cmd_t::GET_PARAM: {
+                param_info_t info;
+                paramInfo(buffer[0], info);
+                uint16_t value = getParam((param_t) buffer[0]);
+                uint8_t param[] = {
+                        (uint8_t) info.type,
+                        (uint8_t) (value >> 8), (uint8_t) value,
+                        (uint8_t) (info.min >> 8), (uint8_t) info.min,
+                        (uint8_t) (info.max >> 8), (uint8_t) info.max,
+                        (uint8_t) (info.def >> 8), (uint8_t) info.def,
+                };
+                btRespond(cmd, state, param, sizeof(param));
+                break;
+            }
+            case cmd_t::SYNC_CLOCK: {
+                uint32_t clock = wallClock();
+                uint8_t time[] = {(uint8_t) (clock >> 24), (uint8_t) (clock >> 16), (uint8_t) (clock >> 8), (uint8_t) clock};
+                btRespond(cmd, state, time, sizeof(time));
+                break;
+            }
+            case cmd_t::STORE_SCENE:
+                // a scene stored into the EEPROM is responded to once it has been written, see respondSlice()
+                if (!storingScene()) btRespond(cmd, state, nullptr, 0);
+                break;
+        }
+    } else {
+        btRespond(cmd, state, nullptr, 0);
+    }
+
+    count = -1;
+    cmd = cmd_t::NONE;
+    state = state_t::INVALID_DATA_LENGTH;
+    receiving = false;
+}
+
+bool btReceiving() { return receiving; }
+
+bool btResponding() { return respondNext != respondEnd || storingScene(); }
+
+
+/**
+ * @brief This function sends a response over the Bluetooth serial connection.
+ *
+ * The function takes a command, a state, a data array, and the length of the data array as parameters.
+ * It first writes the command and the state to the Bluetooth serial connection.
+ * If the data array is not null, it writes the data array to the Bluetooth serial connection.
+ * It then prints a response message to the UART, followed by the state message.
+ * If the state is OK, it prints "[SUCCESS]". If the state is INVALID_DATA_LENGTH, it prints "[INVALID DATA LENGTH]".
+ * If the state is LED_OUT_OF_RANGE, it prints "[LED OUT OF RANGE]".
+ * If the state is INVALID_ARGUMENT, it prints "[INVALID ARGUMENT]". If the state is INVALID_STATE, it prints "[INVALID STATE]".
+ * If the state is INVALID_COMMAND, it prints "[INVALID COMMAND]". For any other state, it prints "[UNKNOWN ERROR]".
+ * Finally, it prints the data array to the UART in hexadecimal format.
+ *
+ * @param cmd The command to be sent.
+ * @param state The state of the command execution.
+ * @param data The data to be sent. Can be null.
+ * @param length The length of the data array.
+ */
+void btRespond(cmd_t cmd, state_t state, const uint8_t *data, size_t length) {
+    btSer.write(static_cast<uint8_t>(cmd));
+    btSer.write(static_cast<uint8_t>(state));
+    if (data) btSer.write(data, length);
+    uart_print("RESPONSE:");
+    switch (state) {
+        case state_t::OK:
+            uart_print(" [SUCCESS]");
+            break;
+        case state_t::INVALID_DATA_LENGTH:
+            uart_print(" [INVALID DATA LENGTH]");
+            break;
+        case state_t::LED_OUT_OF_RANGE:
+            uart_print(" [LED OUT OF RANGE]");
+            break;
+        case state_t::INVALID_ARGUMENT:
+            uart_print(" [INVALID ARGUMENT]");
+            break;
+        case state_t::INVALID_STATE:
+            uart_print(" [INVALID STATE]");
+            break;
+        case state_t::INVALID_COMMAND:
+            uart_print(" [INVALID COMMAND]");
+            break;
+        default:
+            uart_print(" [UNKNOWN ERROR]");
+            break;
+    }
+    for (size_t i = 0; i < length; i++) {
+        uart_print(' ');
+        uart_print(data[i], HEX);
+    }
+    uart_println();
+}
+
+/**
+ * @brief This function starts streaming the colors of a range of LEDs over the Bluetooth serial connection.
+ *
+ * The colors are read from the pixel buffer of the LED strip one LED at a time, so no response buffer is needed.
+ * Each color is written as its red, green and blue components, optionally preceded by the logical number of the LED
+ * truncated to one byte.
+ * The first slice of RESPOND_SLICE_LEDS LEDs is sent at once, the rest by the following calls of btReceive(),
+ * so other tasks keep running while a large range is sent.
+ *
+ * @param first The logical number of the first LED.
+ * @param count The number of LEDs.
+ * @param numbered True if each color is preceded by the number of the LED.
+ */
+void btRespondLeds(uint16_t first, uint16_t count, bool numbered) {
+    respondFirst = respondNext = first;
+    respondEnd = first + count;
+    respondNumbered = numbered;
+    respondSlice();
+}
+
+/**
+ * @brief This function sends the next slice of the LEDs streamed by btRespondLeds(),
+ * or continues storing a scene into the EEPROM and responds to STORE_SCENE once it has been stored.
+ */
+void respondSlice() {
+    if (storingScene()) {
+        if (storeSceneNext()) btRespond(cmd_t::STORE_SCENE, state_t::OK, nullptr, 0);
+        return;
+    }
+    uint16_t end = respondEnd - respondNext > RESPOND_SLICE_LEDS ? respondNext + RESPOND_SLICE_LEDS : respondEnd;
+    for (; respondNext < end; respondNext++) {
+        auto color = leds.getPixelColor(MatrixLayout::index(respondNext));
+        if (respondNumbered) btSer.write((uint8_t) respondNext);
+        btSer.write((uint8_t) (color >> 16));
+        btSer.write((uint8_t) (color >> 8));
+        btSer.write((uint8_t) color);
+    }
+    if (btResponding()) return;
+    uart_print("RESPONDED ");
+    uart_print(respondEnd - respondFirst);
+    uart_println(" LEDS");
+}
+
+
+/**
+ * @brief This function handles the case when no command has been received yet.
+ *
+ * The function takes a reference to a state variable, a reference to a command variable, and a data byte as parameters.
+ * If the data byte matches any of the valid commands, the function sets the command variable to the received command.
+ * Commands without data (GET_LEDS, GET_INFO, CLEAR_OVERLAY, GET_TASKS, STAGE) are complete immediately and the state variable is set to OK.
+ * If the data byte does not match any of the valid commands, the function sets the state variable to INVALID_COMMAND.
+ *
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param cmd The command to be processed. This is a reference parameter and the function may modify its value.
+ * @param data The data byte received. This should be a command code.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdNone(state_t &state, cmd_t &cmd, uint8_t data) {
+    if (state == state_t::INVALID_COMMAND) return consume(data);
+    switch (static_cast<cmd_t>(data)) {
+        case cmd_t::GET_LEDS:
+            uart_println("INFO: CMD GET_LEDS");
+            cmd = cmd_t::GET_LEDS;
+            state = state_t::OK;
+            return true;
+        case cmd_t::GET_INFO:
+            uart_println("INFO: CMD GET_INFO");
+            cmd = cmd_t::GET_INFO;
+            state = state_t::OK;
+            return true;
+        case cmd_t::GET_TASKS:
+            uart_println("INFO: CMD GET_TASKS");
+            cmd = cmd_t::GET_TASKS;
+            state = state_t::OK;
+            return true;
+        case cmd_t::STAGE:
+            uart_println("INFO: CMD STAGE");
+            cmd = cmd_t::STAGE;
+            stageFrames();
+            state = state_t::OK;
+            return true;
+        case cmd_t::CLEAR_OVERLAY:
+            uart_println("INFO: CMD CLEAR_OVERLAY");
+            cmd = cmd_t::CLEAR_OVERLAY;
+            clearOverlay();
+            dirty = true;
+            state = state_t::OK;
+            return true;
+        case cmd_t::SET_LEDS:
+        case cmd_t::SET_LEDS_ALL:
+        case cmd_t::GRADIENT:
+        case cmd_t::PATTERN:
+        case cmd_t::SHIFT:
+        case cmd_t::INSERT_COLUMN:
+        case cmd_t::INSERT_ROW:
+        case cmd_t::SET_RANGE:
+        case cmd_t::FILL_RANGE:
+        case cmd_t::GET_RANGE:
+        case cmd_t::SET_LEDS_16:
+        case cmd_t::SET_EFFECT:
+        case cmd_t::SHOW_TEXT:
+        case cmd_t::WRITE_ANIMATION:
+        case cmd_t::WRITE_SHADER:
+        case cmd_t::SET_OVERLAY:
+        case cmd_t::SET_TRANSITION:
+        case cmd_t::SET_POWER_LIMIT:
+        case cmd_t::SET_BRIGHTNESS:
+        case cmd_t::STORE_SCENE:
+        case cmd_t::RECALL_SCENE:
+        case cmd_t::SYNC_CLOCK:
+        case cmd_t::COMMIT_AT:
+        case cmd_t::GET_PARAM:
+        case cmd_t::SET_PARAM:
+            uart_print("INFO: CMD ");
+            uart_println(data, HEX);
+            cmd = static_cast<cmd_t>(data);
+            return false;
+        default:
+            state = state_t::INVALID_COMMAND;
+            return false;
+    }
+}
+
+/**
+ * @brief This function handles the SET_LEDS command.
+ *
+ * The function takes a count of received bytes, a reference to a state variable, a data array, and a data byte as parameters.
+ * If the count of received bytes is less than Matrix::LED_COUNT * 4 and the state is either INVALID_DATA_LENGTH or OK,
+ * the function stores the data byte in the data array.
+ * If the count of received bytes is a multiple of 4, the function retrieves the LED number and the red, green, and blue components of the color from the data array.
+ * If the LED number is out of range, the function sets the state variable to LED_OUT_OF_RANGE and returns.
+ * Otherwise, the function maps the logical LED number through the matrix layout and sets the color of the specified LED,
+ * sets the mode to BT, and sets the state variable to OK.
+ * If the count of received bytes is greater than or equal to Matrix::LED_COUNT * 4, the function consumes the data.
+ * As the number of LEDs is not known in advance, the command is only complete once no more data is received.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the current LED will be stored. This should be a pointer to an array of size 4.
+ * @param data The data byte received. This should be one of the bytes of the data following the SET_LEDS command.
+ * @return Always false, as the command is complete once no more data is received.
+ */
+bool cmdSetLeds(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    if (count >= Matrix::LED_COUNT * 4 || (state != state_t::INVALID_DATA_LENGTH && state != state_t::OK)) {
+        return consume(data);
+    }
+    buffer[count % 4] = data;
+    if (count % 4 != 3) {
+        state = state_t::INVALID_DATA_LENGTH;
+        return false;
+    }
+    if (buffer[0] >= Matrix::LED_COUNT) {
+        state = state_t::LED_OUT_OF_RANGE;
+        return false;
+    }
+    setLed(buffer[0], buffer[1], buffer[2], buffer[3]);
+    state = state_t::OK;
+    return false;
+}
+
+/**
+ * @brief This function handles the SET_LEDS_ALL command.
+ *
+ * The function takes a count of received bytes, a reference to a state variable, a data array, and a data byte as parameters.
+ * The function stores the data byte in the data array.
+ * Once the red, green, and blue components of the color have been received, it sets the color of all LEDs to the specified color,
+ * sets the mode to BT, and sets the state variable to OK.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the color will be stored. This should be a pointer to an array of size 3.
+ * @param data The data byte received. This should be one of the bytes of the data following the SET_LEDS_ALL command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdSetLedsAll(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    buffer[count] = data;
+    if (count != 2) return false;
+    leds.fill(Adafruit_NeoPixel::Color(buffer[0], buffer[1], buffer[2]));
+    mode = mode_t::BT;
+    dirty = true;
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the GRADIENT command.
+ *
+ * The function takes a count of received bytes, a reference to a state variable, a data array, and a data byte as parameters.
+ * The function stores the data bytes in the data array until the header (type, a, b, number of stops) and all stops have been received.
+ * If the number of stops is out of range, the function sets the state variable to INVALID_ARGUMENT and consumes the rest of the data.
+ * Once the last stop has been received, the gradient is rendered onto the LED strip, the mode is set to BT,
+ * and the state variable is set to OK. If the parameters of the gradient are invalid, the state variable is set to INVALID_ARGUMENT instead.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the gradient parameters will be stored. This should be a pointer to an array of size 4 + GRADIENT_MAX_STOPS * 4.
+ * @param data The data byte received. This should be one of the bytes of the data following the GRADIENT command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdGradient(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    buffer[count] = data;
+    if (count == 3 && (data < GRADIENT_MIN_STOPS || data > GRADIENT_MAX_STOPS)) {
+        state = state_t::INVALID_ARGUMENT;
+        return false;
+    }
+    if (count < 4 || count != 3 + buffer[3] * 4) return false;
+
+    gradient_stop_t stops[GRADIENT_MAX_STOPS];
+    for (uint8_t i = 0; i < buffer[3]; i++) {
+        stops[i].pos = buffer[4 + i * 4];
+        stops[i].color = color_t(buffer[5 + i * 4], buffer[6 + i * 4], buffer[7 + i * 4]);
+    }
+    if (!renderGradient(leds, static_cast<gradient_t>(buffer[0]), buffer[1], buffer[2], stops, buffer[3])) {
+        state = state_t::INVALID_ARGUMENT;
+        return false;
+    }
+    mode = mode_t::BT;
+    dirty = true;
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the PATTERN command.
+ *
+ * The function takes a count of received bytes, a reference to a state variable, a data array, and a data byte as parameters.
+ * The function stores the data byte in the data array.
+ * Once all 8 parameter bytes have been received, the pattern is rendered onto the LED strip, the mode is set to BT,
+ * and the state variable is set to OK. If the parameters of the pattern are invalid, the state variable is set to INVALID_ARGUMENT instead.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the pattern parameters will be stored. This should be a pointer to an array of size 8.
+ * @param data The data byte received. This should be one of the bytes of the data following the PATTERN command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdPattern(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    buffer[count] = data;
+    if (count != 7) return false;
+
+    color_t c1(buffer[2], buffer[3], buffer[4]);
+    color_t c2(buffer[5], buffer[6], buffer[7]);
+    if (!renderPattern(leds, static_cast<pattern_t>(buffer[0]), buffer[1], c1, c2)) {
+        state = state_t::INVALID_ARGUMENT;
+        return false;
+    }
+    mode = mode_t::BT;
+    dirty = true;
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the SHIFT command.
+ *
+ * The function takes a count of received bytes, a reference to a state variable, a data array, and a data byte as parameters.
+ * The function stores the data byte in the data array.
+ * Once all 6 parameter bytes have been received, the content of the LED strip is shifted in place,
+ * the mode is set to BT, and the state variable is set to OK. If the wrap flag is invalid, the state variable is set to INVALID_ARGUMENT.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the shift parameters will be stored. This should be a pointer to an array of size 6.
+ * @param data The data byte received. This should be one of the bytes of the data following the SHIFT command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdShift(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    buffer[count] = data;
+    if (count == 2 && data > 1) {
+        state = state_t::INVALID_ARGUMENT;
+        return false;
+    }
+    if (count != 5) return false;
+
+    shiftPixels(leds, (int8_t) buffer[0], (int8_t) buffer[1], buffer[2] != 0, color_t(buffer[3], buffer[4], buffer[5]));
+    mode = mode_t::BT;
+    dirty = true;
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the INSERT_COLUMN and INSERT_ROW commands.
+ *
+ * The edge and the colors of the new pixels are stored in the data array as they are received.
+ * Once all colors have been received, the content of the LED strip is shifted by one column or row away from the edge,
+ * the colors are written to the vacated edge, the mode is set to BT, and the state variable is set to OK.
+ * A command cut short therefore leaves the LED strip unchanged.
+ * If the edge is invalid, the state variable is set to INVALID_ARGUMENT and the rest of the data is consumed.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the edge and the colors will be stored. This should be a pointer to an array of size INSERT_PARAMS_SIZE.
+ * @param data The data byte received.
+ * @param column True if a column is inserted, false if a row is inserted.
+ * @return True if the command is complete, false if more data is expected.
+ */
+static bool insertEdge(int16_t count, state_t &state, uint8_t *buffer, uint8_t data, bool column) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    if (count == 0 && data > 1) {
+        state = state_t::INVALID_ARGUMENT;
+        return false;
+    }
+    buffer[count] = data;
+    uint8_t length = column ? MatrixLayout::HEIGHT : MatrixLayout::WIDTH;
+    if (count != length * 3) return false;
+
+    // edge 0x00 inserts at the right or bottom edge, so the content moves towards the origin
+    auto step = (int8_t) (buffer[0] == 0 ? -1 : 1);
+    shiftPixels(leds, column ? step : 0, column ? 0 : step, false, color_t());
+    uint8_t edge = buffer[0] == 0 ? (column ? MatrixLayout::WIDTH : MatrixLayout::HEIGHT) - 1 : 0;
+    for (uint8_t i = 0; i < length; i++) {
+        uint16_t n = column ? MatrixLayout::xy(edge, i) : MatrixLayout::xy(i, edge);
+        const uint8_t *c = buffer + 1 + i * 3;
+        leds.setPixelColor(n, c[0], c[1], c[2]);
+    }
+    mode = mode_t::BT;
+    dirty = true;
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the INSERT_COLUMN command.
+ *
+ * @see insertEdge
+ */
+bool cmdInsertColumn(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    return insertEdge(count, state, buffer, data, true);
+}
+
+/**
+ * @brief This function handles the INSERT_ROW command.
+ *
+ * @see insertEdge
+ */
+bool cmdInsertRow(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    return insertEdge(count, state, buffer, data, false);
+}
+
+/**
+ * @brief Check the range header (start and count) of a range command once it has been received.
+ *
+ * @param buffer The data array holding the header.
+ * @param state The state of the command execution. Set to LED_OUT_OF_RANGE if the range exceeds the matrix.
+ * @return True if the range is valid, false otherwise.
+ */
+static bool checkRange(const uint8_t *buffer, state_t &state) {
+    if ((uint32_t) be16(buffer) + be16(buffer + 2) > Matrix::LED_COUNT) {
+        state = state_t::LED_OUT_OF_RANGE;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief This function handles the SET_RANGE command.
+ *
+ * The function stores the start and count of the range in the data array and checks that the range lies within the matrix.
+ * The colors of the LEDs are then written to the LED strip as they are received, so the whole frame never has to be buffered.
+ * Once all colors have been received, the mode is set to BT, and the state variable is set to OK.
+ * If the range exceeds the matrix, the state variable is set to LED_OUT_OF_RANGE and the rest of the data is consumed.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the range and the current color will be stored. This should be a pointer to an array of size 7.
+ * @param data The data byte received. This should be one of the bytes of the data following the SET_RANGE command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdSetRange(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    if (count < 4) {
+        buffer[count] = data;
+        if (count != 3 || !checkRange(buffer, state)) return false;
+        if (be16(buffer + 2) != 0) return false;
+        state = state_t::OK;
+        return true;
+    }
+
+    buffer[4 + (count - 4) % 3] = data;
+    if ((count - 4) % 3 != 2) return false;
+    uint16_t i = (count - 4) / 3;
+    setLed(be16(buffer) + i, buffer[4], buffer[5], buffer[6]);
+    if (i != be16(buffer + 2) - 1) return false;
+
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the FILL_RANGE command.
+ *
+ * The function stores the start and count of the range and the color in the data array.
+ * Once all 7 parameter bytes have been received, all LEDs of the range are set to the color, the mode is set to BT,
+ * and the state variable is set to OK. If the range exceeds the matrix, the state variable is set to LED_OUT_OF_RANGE.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the parameters will be stored. This should be a pointer to an array of size 7.
+ * @param data The data byte received. This should be one of the bytes of the data following the FILL_RANGE command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdFillRange(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    buffer[count] = data;
+    if (count != 6 || !checkRange(buffer, state)) return false;
+
+    uint16_t end = be16(buffer) + be16(buffer + 2);
+    for (uint16_t n = be16(buffer); n < end; n++) {
+        setLed(n, buffer[4], buffer[5], buffer[6]);
+    }
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the GET_RANGE command.
+ *
+ * The function stores the start and count of the range in the data array.
+ * Once both have been received and the range lies within the matrix, the state variable is set to OK,
+ * and the colors are streamed directly from the LED strip when responding.
+ * If the range exceeds the matrix, the state variable is set to LED_OUT_OF_RANGE.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the range will be stored. This should be a pointer to an array of size 4.
+ * @param data The data byte received. This should be one of the bytes of the data following the GET_RANGE command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdGetRange(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    buffer[count] = data;
+    if (count != 3 || !checkRange(buffer, state)) return false;
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the SET_LEDS_16 command.
+ *
+ * The function stores the number of LEDs in the data array.
+ * Each LED is then received as its 16 bit number followed by its color and written to the LED strip immediately.
+ * Once all LEDs have been received, the mode is set to BT, and the state variable is set to OK.
+ * If a LED number is out of range, the state variable is set to LED_OUT_OF_RANGE and the rest of the data is consumed.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the number of LEDs and the current LED will be stored. This should be a pointer to an array of size 7.
+ * @param data The data byte received. This should be one of the bytes of the data following the SET_LEDS_16 command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdSetLeds16(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    if (count < 2) {
+        buffer[count] = data;
+        if (count != 1 || be16(buffer) != 0) return false;
+        state = state_t::OK;
+        return true;
+    }
+
+    buffer[2 + (count - 2) % 5] = data;
+    if ((count - 2) % 5 != 4) return false;
+    uint16_t n = be16(buffer + 2);
+    if (n >= Matrix::LED_COUNT) {
+        state = state_t::LED_OUT_OF_RANGE;
+        return false;
+    }
+    setLed(n, buffer[4], buffer[5], buffer[6]);
+    if ((count - 2) / 5 != be16(buffer) - 1) return false;
+
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the SET_EFFECT command.
+ *
+ * The function stores the effect ID, the number of parameters and the parameters in the data array.
+ * If the effect ID or the number of parameters is invalid, the state variable is set to INVALID_ARGUMENT
+ * and the rest of the data is consumed.
+ * Once all parameters have been received, the effect is selected, the mode is set to EFFECT, and the state variable is set to OK.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the effect and its parameters will be stored. This should be a pointer to an array of size 2 + EFFECT_MAX_PARAMS.
+ * @param data The data byte received. This should be one of the bytes of the data following the SET_EFFECT command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdSetEffect(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    buffer[count] = data;
+    if ((count == 0 && data >= EFFECT_COUNT) || (count == 1 && data > EFFECT_MAX_PARAMS)) {
+        state = state_t::INVALID_ARGUMENT;
+        return false;
+    }
+    if (count < 1 || count != 1 + buffer[1]) return false;
+
+    selectEffect(buffer[0], buffer + 2, buffer[1]);
+    mode = mode_t::EFFECT;
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the SHOW_TEXT command.
+ *
+ * The function stores the color, the step time, the length and the characters of the text in the data array.
+ * If the text is too long, the state variable is set to INVALID_ARGUMENT and the rest of the data is consumed.
+ * Once all characters have been received, the text is set, the TEXT effect is selected with the color and the step time,
+ * the mode is set to EFFECT, and the state variable is set to OK.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the parameters and the text will be stored. This should be a pointer to an array of size 5 + TEXT_MAX_LENGTH.
+ * @param data The data byte received. This should be one of the bytes of the data following the SHOW_TEXT command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdShowText(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    buffer[count] = data;
+    if (count == 4 && data > TEXT_MAX_LENGTH) {
+        state = state_t::INVALID_ARGUMENT;
+        return false;
+    }
+    if (count < 4 || count != 4 + buffer[4]) return false;
+
+    setText(reinterpret_cast<const char *>(buffer + 5), buffer[4]);
+    selectEffect(static_cast<uint8_t>(effect_id_t::TEXT), buffer, 4);
+    mode = mode_t::EFFECT;
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the WRITE_ANIMATION command.
+ *
+ * The function receives a chunk of the keyframe animation and writes it into the EEPROM, see writeChunk().
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the chunk will be stored. This should be a pointer to an array of size 3 + STORAGE_CHUNK_SIZE.
+ * @param data The data byte received. This should be one of the bytes of the data following the WRITE_ANIMATION command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdWriteAnimation(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    return writeChunk(count, state, buffer, data, writeAnimation);
+}
+
+/**
+ * @brief This function handles the WRITE_SHADER command.
+ *
+ * The function receives a chunk of the shader program and writes it into the EEPROM, see writeChunk().
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the chunk will be stored. This should be a pointer to an array of size 3 + STORAGE_CHUNK_SIZE.
+ * @param data The data byte received. This should be one of the bytes of the data following the WRITE_SHADER command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdWriteShader(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    return writeChunk(count, state, buffer, data, writeShader);
+}
+
+/**
+ * @brief This function handles the SET_OVERLAY command.
+ *
+ * The function stores the blend mode and the number of LEDs in the data array.
+ * Each LED is then received as its 16 bit number followed by its color and alpha and added to the overlay immediately.
+ * Once all LEDs have been received, the state variable is set to OK; the mode is kept, so the overlay is drawn
+ * over an effect as well as over the colors set over Bluetooth.
+ * If the blend mode is invalid, a LED number is out of range or the overlay is full, the state variable is set to
+ * INVALID_ARGUMENT, LED_OUT_OF_RANGE or INVALID_STATE, and the rest of the data is consumed.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the header and the current LED will be stored. This should be a pointer to an array of size 8.
+ * @param data The data byte received. This should be one of the bytes of the data following the SET_OVERLAY command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdSetOverlay(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    if (state != state_t::INVALID_DATA_LENGTH) return consume(data);
+    if (count < 2) {
+        buffer[count] = data;
+        if (count == 0) {
+            if (setOverlayBlend(data) != state_t::OK) state = state_t::INVALID_ARGUMENT;
+            return false;
+        }
+        dirty = true;
+        if (data != 0) return false;
+        state = state_t::OK;
+        return true;
+    }
+
+    buffer[2 + (count - 2) % 6] = data;
+    if ((count - 2) % 6 != 5) return false;
+    state_t result = setOverlayPixel(be16(buffer + 2), color_t(buffer[4], buffer[5], buffer[6]), buffer[7]);
+    if (result != state_t::OK) {
+        state = result;
+        return false;
+    }
+    if ((count - 2) / 6 != buffer[1] - 1) return false;
+
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the SET_TRANSITION command.
+ *
+ * The function stores the transition time in the data array.
+ * Once it has been received, it is used for all following transitions, and the state variable is set to OK.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the transition time will be stored. This should be a pointer to an array of size 2.
+ * @param data The data byte received. This should be one of the bytes of the data following the SET_TRANSITION command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdSetTransition(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    buffer[count] = data;
+    if (count != 1) return false;
+    setTransitionTime(be16(buffer));
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the SET_POWER_LIMIT command.
+ *
+ * The function stores the power limit in the data array.
+ * Once it has been received, it is applied to all following frames, the LEDs are shown again with it,
+ * and the state variable is set to OK.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the power limit will be stored. This should be a pointer to an array of size 2.
+ * @param data The data byte received. This should be one of the bytes of the data following the SET_POWER_LIMIT command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdSetPowerLimit(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    buffer[count] = data;
+    if (count != 1) return false;
+    setPowerLimit(be16(buffer));
+    dirty = true;
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the SET_BRIGHTNESS command.
+ *
+ * The brightness is applied to all following frames, the LEDs are shown again with it, and the state variable is set to OK.
+ * The colors of the LED strip are not changed, so they are reported in full by GET_LEDS and GET_RANGE.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array. Not used, as the command has a single data byte.
+ * @param data The data byte received. This should be the brightness following the SET_BRIGHTNESS command.
+ * @return Always true, as the command is complete with its first data byte.
+ */
+bool cmdSetBrightness(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    setGlobalBrightness(data);
+    dirty = true;
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the STORE_SCENE command.
+ *
+ * The pixel buffer of the LED strip is stored as scene into the slot, see storeScene(), and the state variable is set
+ * to the result. A slot in the EEPROM is written while the response is pending, so the pixel buffer stays unchanged.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array. Not used, as the command has a single data byte.
+ * @param data The data byte received. This should be the slot following the STORE_SCENE command.
+ * @return Always true, as the command is complete with its first data byte.
+ */
+bool cmdStoreScene(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    state = storeScene(data);
+    return true;
+}
+
+/**
+ * @brief This function handles the RECALL_SCENE command.
+ *
+ * The function stores the slot and the fade time in the data array.
+ * Once they have been received, the scene is set as the colors of the LEDs and crossfaded to, see recallScene(),
+ * and the state variable is set to the result.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the slot and the fade time will be stored. This should be a pointer to an array of size 3.
+ * @param data The data byte received. This should be one of the bytes of the data following the RECALL_SCENE command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdRecallScene(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    buffer[count] = data;
+    if (count != 2) return false;
+    state = recallScene(buffer[0], be16(buffer + 1));
+    if (state == state_t::OK) dirty = true;
+    return true;
+}
+
+/**
+ * @brief This function handles the SYNC_CLOCK command.
+ *
+ * The function stores the adjustment in the data array.
+ * Once it has been received, the wall clock is moved by it, see adjustClock(), and the state variable is set to OK.
+ * The response holds the wall clock after the adjustment, so the host can measure the remaining offset.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the adjustment will be stored. This should be a pointer to an array of size 4.
+ * @param data The data byte received. This should be one of the bytes of the data following the SYNC_CLOCK command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdSyncClock(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    buffer[count] = data;
+    if (count != 3) return false;
+    adjustClock((int32_t) be32(buffer));
+    state = state_t::OK;
+    return true;
+}
+
+/**
+ * @brief This function handles the COMMIT_AT command.
+ *
+ * The function stores the time of the commit in the data array.
+ * Once it has been received, the staged frames are committed, see commitFrames(), and the state variable is set
+ * to the result.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the time will be stored. This should be a pointer to an array of size 4.
+ * @param data The data byte received. This should be one of the bytes of the data following the COMMIT_AT command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdCommitAt(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    buffer[count] = data;
+    if (count != 3) return false;
+    state = commitFrames(be32(buffer));
+    return true;
+}
+
+/**
+ * @brief This function handles the GET_PARAM command.
+ *
+ * The function stores the ID of the parameter in the data array and sets the state variable to OK,
+ * or to INVALID_ARGUMENT if there is no such parameter. The parameter is reported by the response.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the ID of the parameter will be stored. This should be a pointer to an array of size 1.
+ * @param data The data byte received. This should be the ID of the parameter following the GET_PARAM command.
+ * @return Always true, as the command is complete with its first data byte.
+ */
+bool cmdGetParam(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    param_info_t info;
+    buffer[0] = data;
+    state = paramInfo(data, info) ? state_t::OK : state_t::INVALID_ARGUMENT;
+    return true;
+}
+
+/**
+ * @brief This function handles the SET_PARAM command.
+ *
+ * The function stores the ID and the value of the parameter in the data array.
+ * Once they have been received, the value is set, see setParam(), and the state variable is set to the result.
+ *
+ * @param count The count of received bytes.
+ * @param state The state of the command execution. This is a reference parameter and the function may modify its value.
+ * @param buffer The data array where the ID and the value will be stored. This should be a pointer to an array of size 3.
+ * @param data The data byte received. This should be one of the bytes of the data following the SET_PARAM command.
+ * @return True if the command is complete, false if more data is expected.
+ */
+bool cmdSetParam(int16_t count, state_t &state, uint8_t *buffer, uint8_t data) {
+    buffer[count] = data;
+    if (count != 2) return false;
+    state = setParam(buffer[0], be16(buffer + 1));
+    return true;
+}
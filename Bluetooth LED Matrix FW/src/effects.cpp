@@ -0,0 +1,345 @@
+#include "effects.h"
+#include "tables.h"
+#include "life.h"
+#include "text.h"
+#include "animation.h"
+#include "shader.h"
+#include "particles.h"
+#include "output.h"
+#include "params.h"
+#include "uart_serial.h"
+
+using L = MatrixLayout;
+
+
+static uint8_t scratch[EFFECT_SCRATCH_SIZE]; ///< The state of the selected effect.
+static uint8_t params[EFFECT_MAX_PARAMS]; ///< The parameters of the selected effect.
+static uint8_t current = 0; ///< The ID of the selected effect.
+static bool selected = false; ///< False until the scratch memory has been prepared for the selected effect.
+
+
+/**
+ * @brief Get a parameter of the selected effect or its default.
+ *
+ * @param p The parameters of the effect.
+ * @param i The index of the parameter.
+ * @param fallback The default of the parameter, used if it is 0.
+ * @return The parameter.
+ */
+static uint8_t param(const uint8_t *p, uint8_t i, uint8_t fallback) { return p[i] ? p[i] : fallback; }
+
+/**
+ * @brief Get a color parameter of the selected effect or its default.
+ *
+ * @param p The parameters of the effect.
+ * @param i The index of the red component of the color.
+ * @param fallback The default of the color, used if all components are 0.
+ * @return The color.
+ */
+static color_t colorParam(const uint8_t *p, uint8_t i, const color_t &fallback) {
+    return (p[i] | p[i + 1] | p[i + 2]) ? color_t(p[i], p[i + 1], p[i + 2]) : fallback;
+}
+
+/**
+ * @brief Set the color of a pixel by its coordinates.
+ *
+ * @param leds The LED strip.
+ * @param x The column, counted from the left.
+ * @param y The row, counted from the top.
+ * @param c The color of the pixel.
+ */
+static void setXY(Adafruit_NeoPixel &leds, uint8_t x, uint8_t y, const color_t &c) {
+    leds.setPixelColor(L::xy(x, y), c.r, c.g, c.b);
+}
+
+
+/*
+ * RANDOM
+ *      no parameters
+ *      every LED fades one step per frame towards a random target color and picks a new target once it is reached
+ *      scratch: the target color of each LED
+ */
+
+static void randomInit(Adafruit_NeoPixel &, const uint8_t *, uint8_t *s) { memset(s, 0, Matrix::LED_COUNT * sizeof(color_t)); }
+
+/**
+ * @brief This function generates random colors for each LED in the LED array.
+ *
+ * The scratch memory holds the target color that each LED is fading to.
+ * The current color of each LED is read back from the pixel buffer of the LED strip, so it needs no extra buffer.
+ *
+ * The function works as follows:
+ * 1. For each LED, if its current color is the same as its target color, a new random target color is generated.
+ * 2. Each LED's current color is then faded towards its target color.
+ * 3. The color of each LED in the LED strip is updated to its new current color.
+ */
+static bool randomRender(Adafruit_NeoPixel &leds, uint32_t, const uint8_t *, uint8_t *s) {
+    auto target = reinterpret_cast<color_t *>(s); // Target color of each LED
+    auto step = (uint8_t) getParam(param_t::FADE_STEP);
+    auto low = (uint8_t) getParam(param_t::RANDOM_LOW);
+
+    for (Matrix::index_t i = 0; i < Matrix::LED_COUNT; i++) {
+        // The current color of the LED is read back from the LED strip
+        color_t current(leds.getPixelColor(i));
+        // If the current color is the same as the target color, generate a new random target color
+        if (current == target[i]) target[i].setRandom(low);
+        // Fade the current color towards the target color
+        current.fadeTo(target[i], step);
+        // Update the color of the LED in the LED strip
+        leds.setPixelColor(i, current.r, current.g, current.b);
+    }
+    return true;
+}
+
+
+/*
+ * PLASMA
+ *      params: speed (default 8), scale (default 32)
+ *      the sum of three sine waves (horizontal, vertical and diagonal) is mapped onto the color wheel
+ */
+
+static void plasmaInit(Adafruit_NeoPixel &, const uint8_t *, uint8_t *) {}
+
+static bool plasmaRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *p, uint8_t *) {
+    auto phase = (uint8_t) ((t * param(p, 0, 8)) >> 6);
+    uint8_t scale = param(p, 1, 32);
+    for (uint8_t y = 0; y < L::HEIGHT; y++) {
+        uint8_t wy = sin8((uint8_t) (y * scale - phase));
+        for (uint8_t x = 0; x < L::WIDTH; x++) {
+            uint16_t v = sin8((uint8_t) (x * scale + phase)) + wy + sin8((uint8_t) ((x + y) * scale / 2 + phase * 2));
+            setXY(leds, x, y, color_t::wheel((uint8_t) (v / 3 + phase)));
+        }
+    }
+    return true;
+}
+
+
+/*
+ * FIRE
+ *      params: cooling (default 55), sparking (default 120)
+ *      every cell has a heat that cools down, rises to the cell above and is reignited at the bottom row
+ *      the cooling of each cell is modulated with noise, so the flames flicker without a random number per pixel
+ *      scratch: the heat of each cell, row by row from the top left
+ */
+
+static void fireInit(Adafruit_NeoPixel &, const uint8_t *, uint8_t *s) { memset(s, 0, Matrix::LED_COUNT); }
+
+/**
+ * @brief Map a heat to the color of a flame: black, red, yellow, white.
+ *
+ * @param heat The heat.
+ * @return The color of the heat.
+ */
+static color_t heatColor(uint8_t heat) {
+    uint8_t t = scale8(heat, 191);
+    auto ramp = (uint8_t) ((t & 0x3F) << 2);
+    if (t & 0x80) return {255, 255, ramp};
+    if (t & 0x40) return {255, ramp, 0};
+    return {ramp, 0, 0};
+}
+
+static bool fireRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *p, uint8_t *heat) {
+    uint8_t cooling = min(param(p, 0, 55) * 10 / L::HEIGHT + 2, 255);
+    uint8_t sparking = param(p, 1, 120);
+
+    // cool down every cell
+    for (uint8_t y = 0; y < L::HEIGHT; y++) {
+        for (uint8_t x = 0; x < L::WIDTH; x++) {
+            uint8_t &h = heat[y * L::WIDTH + x];
+            uint8_t cool = scale8(noise8(x * 96, (uint16_t) (y * 96 + (t >> 2))), cooling);
+            h = h > cool ? h - cool : 0;
+        }
+    }
+    // let the heat rise and diffuse, the bottom row keeps its heat
+    for (uint8_t y = 0; y + 1 < L::HEIGHT; y++) {
+        uint8_t below = y + 2 < L::HEIGHT ? y + 2 : y + 1;
+        for (uint8_t x = 0; x < L::WIDTH; x++) {
+            heat[y * L::WIDTH + x] = (heat[(y + 1) * L::WIDTH + x] + 2 * heat[below * L::WIDTH + x]) / 3;
+        }
+    }
+    // ignite new sparks at the bottom row
+    if (random(256) < sparking) {
+        uint8_t &h = heat[(L::HEIGHT - 1) * L::WIDTH + random(L::WIDTH)];
+        h = (uint8_t) min(h + random(160, 256), 255);
+    }
+
+    for (uint8_t y = 0; y < L::HEIGHT; y++) {
+        for (uint8_t x = 0; x < L::WIDTH; x++) {
+            setXY(leds, x, y, heatColor(heat[y * L::WIDTH + x]));
+        }
+    }
+    return true;
+}
+
+
+/*
+ * RAIN
+ *      params: r, g, b (default 0, 64, 255), density (default 40), trail (default 160)
+ *      density = chance per frame and column out of 256 that a new drop starts
+ *      trail = brightness the trail keeps per frame out of 256
+ *      scratch: the row of the drop of each column, 0xFF if there is none
+ */
+
+static void rainInit(Adafruit_NeoPixel &, const uint8_t *, uint8_t *s) { memset(s, 0xFF, L::WIDTH); }
+
+static bool rainRender(Adafruit_NeoPixel &leds, uint32_t, const uint8_t *p, uint8_t *drops) {
+    color_t color = colorParam(p, 0, {0, 64, 255});
+    uint8_t density = param(p, 3, 40);
+    uint8_t trail = param(p, 4, 160);
+
+    // fade the trails; the brightness of every byte of the pixel buffer scales independent of the layout
+    uint8_t *pixels = leds.getPixels();
+    for (uint16_t i = 0; i < Matrix::LED_COUNT * Matrix::BYTES_PER_PIXEL; i++) pixels[i] = scale8(pixels[i], trail);
+
+    for (uint8_t x = 0; x < L::WIDTH; x++) {
+        if (drops[x] != 0xFF && ++drops[x] >= L::HEIGHT) drops[x] = 0xFF;
+        if (drops[x] == 0xFF && random(256) < density) drops[x] = 0;
+        if (drops[x] != 0xFF) setXY(leds, x, drops[x], color);
+    }
+    return true;
+}
+
+
+/*
+ * RAINBOW
+ *      params: speed (default 4), scale (default 16), direction (0 horizontal, 1 vertical, 2 diagonal)
+ *      the color wheel moves across the matrix, scale is the hue step between neighboring pixels
+ */
+
+static void rainbowInit(Adafruit_NeoPixel &, const uint8_t *, uint8_t *) {}
+
+static bool rainbowRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *p, uint8_t *) {
+    auto phase = (uint8_t) ((t * param(p, 0, 4)) >> 4);
+    uint8_t scale = param(p, 1, 16);
+    uint8_t direction = p[2];
+    for (uint8_t y = 0; y < L::HEIGHT; y++) {
+        for (uint8_t x = 0; x < L::WIDTH; x++) {
+            uint8_t pos = direction == 0 ? x : direction == 1 ? y : x + y;
+            setXY(leds, x, y, color_t::wheel((uint8_t) (pos * scale - phase)));
+        }
+    }
+    return true;
+}
+
+
+/*
+ * BREATHING
+ *      params: r, g, b (default: a new hue every breath), period in 100 ms (default 40)
+ *      the brightness follows a sine wave and is squared, so the eye perceives it as even
+ */
+
+static void breathingInit(Adafruit_NeoPixel &, const uint8_t *, uint8_t *) {}
+
+static bool breathingRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *p, uint8_t *) {
+    uint32_t period = param(p, 3, 40) * 100ul;
+    auto phase = (uint8_t) ((t % period) * 256 / period);
+    uint8_t level = sin8((uint8_t) (phase - 64)); // start dark
+    color_t color = colorParam(p, 0, color_t::wheel((uint8_t) (t / period * 37)));
+    leds.fill((uint32_t) color.scaled(scale8(level, level)));
+    return true;
+}
+
+
+/// The registry of all effects, indexed by their ID.
+static const effect_t EFFECTS[EFFECT_COUNT] PROGMEM = {
+        {randomInit, randomRender, 0}, // the FRAME_DELAY parameter
+        {plasmaInit, plasmaRender, 20},
+        {fireInit, fireRender, 30},
+        {rainInit, rainRender, 60},
+        {rainbowInit, rainbowRender, 20},
+        {breathingInit, breathingRender, 20},
+        {lifeInit, lifeRender, 20},
+        {textInit, textRender, 10},
+        {animationInit, animationRender, 20},
+        {shaderInit, shaderRender, 20},
+        {particlesInit, particlesRender, 20},
+};
+
+/**
+ * @brief Read an entry of the effect registry from the flash memory.
+ *
+ * @param id The ID of the effect.
+ * @return The entry of the effect.
+ */
+static effect_t getEffect(uint8_t id) {
+    effect_t effect;
+    memcpy_P(&effect, &EFFECTS[id], sizeof(effect_t));
+    if (effect.frameTime == 0) effect.frameTime = getParam(param_t::FRAME_DELAY);
+    return effect;
+}
+
+
+bool selectEffect(uint8_t id, const uint8_t *p, uint8_t count) {
+    if (id >= EFFECT_COUNT || count > EFFECT_MAX_PARAMS) return false;
+    memset(params, 0, EFFECT_MAX_PARAMS);
+    if (count) memcpy(params, p, count);
+    current = id;
+    selected = false;
+    startTransition();
+    return true;
+}
+
+void nextEffect() { selectEffect((uint8_t) ((current + 1) % EFFECT_COUNT), nullptr, 0); }
+
+uint8_t selectedEffect() { return current; }
+
+const uint8_t *effectParams() { return params; }
+
+uint16_t renderEffect(Adafruit_NeoPixel &leds) {
+    static uint32_t last = 0;
+    effect_t effect = getEffect(current);
+    if (!selected) {
+        effect.init(leds, params, scratch);
+        selected = true;
+    } else {
+        uint32_t passed = millis() - last;
+        if (passed < effect.frameTime) return (uint16_t) (effect.frameTime - passed);
+    }
+    last = millis();
+    if (effect.render(leds, last, params, scratch)) showFrame();
+    return effect.frameTime;
+}
+
+#ifdef BENCHMARK
+/**
+ * @brief Measure the longest time a frame of the selected effect takes to render and print it to the UART.
+ *
+ * @param leds The LED strip to render onto.
+ * @param effect The entry of the effect, whose scratch memory has been prepared.
+ * @param note The note printed after the ID of the effect.
+ */
+static void benchmarkEffect(Adafruit_NeoPixel &leds, const effect_t &effect, const char *note) {
+    uint32_t worst = 0;
+    for (uint8_t frame = 0; frame < BENCHMARK_FRAMES; frame++) {
+        uint32_t start = micros();
+        effect.render(leds, (uint32_t) frame * effect.frameTime, params, scratch);
+        uint32_t time = micros() - start;
+        if (time > worst) worst = time;
+    }
+    uart_print("BENCHMARK EFFECT ");
+    uart_print(current, HEX);
+    uart_print(note);
+    uart_print(": ");
+    uart_print(worst);
+    uart_println(" US");
+}
+
+void benchmarkEffects(Adafruit_NeoPixel &leds) {
+    memset(params, 0, EFFECT_MAX_PARAMS);
+    for (current = 0; current < EFFECT_COUNT; current++) {
+        effect_t effect = getEffect(current);
+        effect.init(leds, params, scratch);
+        benchmarkEffect(leds, effect, "");
+    }
+
+    current = static_cast<uint8_t>(effect_id_t::PARTICLES);
+    effect_t effect = getEffect(current);
+    effect.init(leds, params, scratch);
+    particlesFill(scratch);
+    benchmarkEffect(leds, effect, " (FULL POOL)");
+
+    leds.clear();
+    current = 0;
+    selected = false;
+}
+#endif
@@ -0,0 +1,165 @@
+#include "life.h"
+#include "color.h"
+#include "config.h"
+#include "effects.h"
+#include "tables.h"
+
+using L = MatrixLayout;
+
+static_assert(L::WIDTH <= 32, "a row of the board must fit into a machine word");
+
+/// The smallest unsigned type that holds a row of the board, one bit per column (bit x = column x).
+using row_t = select_type<(L::WIDTH <= 8), uint8_t,
+        select_type<(L::WIDTH <= 16), uint16_t, uint32_t>::type>::type;
+
+constexpr row_t ROW_MASK = (row_t) (((uint32_t) 1 << (L::WIDTH - 1)) * 2 - 1); ///< The bits of the columns of a row.
+
+/**
+ * @struct life_t
+ * @brief The state of the cellular automaton, stored in the scratch memory of the effects.
+ */
+struct life_t {
+    row_t rows[L::HEIGHT]; ///< The board, one bit per cell.
+    uint32_t lastStep; ///< The time of the last generation in milliseconds.
+};
+
+static_assert(sizeof(life_t) <= EFFECT_SCRATCH_SIZE, "the board must fit into the scratch memory of the effects");
+
+constexpr uint8_t FLAG_BOUNDED = 0x01; ///< The edges of the board do not wrap around.
+constexpr uint8_t FLAG_SEED_FRAME = 0x02; ///< The board is seeded from the current frame.
+constexpr uint8_t FLAG_LITERAL_SURVIVAL = 0x04; ///< A survival mask of 0 means no cell survives.
+constexpr uint8_t TRAIL = 160; ///< The brightness dead cells keep per frame out of 256.
+
+
+/**
+ * @brief Seed the board randomly with about a third of the cells alive.
+ *
+ * @param life The state of the automaton.
+ */
+static void seedRandom(life_t &life) {
+    for (uint8_t y = 0; y < L::HEIGHT; y++) {
+        row_t row = 0;
+        for (uint8_t x = 0; x < L::WIDTH; x++) {
+            if (random(3) == 0) row |= (row_t) 1 << x;
+        }
+        life.rows[y] = row;
+    }
+}
+
+/**
+ * @brief Add a row of neighbors to a bit-sliced counter.
+ *
+ * Every bit position counts on its own: s[0] to s[3] hold the bits 0 to 3 of the count of that position.
+ *
+ * @param s The bit slices of the counter.
+ * @param n The neighbor row to add.
+ */
+static inline void count(row_t *s, row_t n) {
+    row_t carry = s[0] & n;
+    s[0] ^= n;
+    row_t carry2 = s[1] & carry;
+    s[1] ^= carry;
+    carry = s[2] & carry2;
+    s[2] ^= carry2;
+    s[3] |= carry;
+}
+
+/**
+ * @brief Select the bit positions whose counter equals a value.
+ *
+ * @param s The bit slices of the counter.
+ * @param n The value.
+ * @return The bit positions whose counter equals n.
+ */
+static inline row_t equals(const row_t *s, uint8_t n) {
+    return (n & 1 ? s[0] : ~s[0]) & (n & 2 ? s[1] : ~s[1]) & (n & 4 ? s[2] : ~s[2]) & (n & 8 ? s[3] : ~s[3]);
+}
+
+/**
+ * @brief Advance the board by one generation.
+ *
+ * @param life The state of the automaton.
+ * @param birth The birth mask, bit n - 1 is set if a cell is born with n neighbors.
+ * @param survival The survival mask, bit n - 1 is set if a cell survives with n neighbors.
+ * @param wrap True if the edges wrap around.
+ * @return True if the board has changed.
+ */
+static bool step(life_t &life, uint8_t birth, uint8_t survival, bool wrap) {
+    bool changed = false;
+    row_t first = life.rows[0]; // the first row is overwritten before the last row needs it as neighbor
+    row_t above = wrap ? life.rows[L::HEIGHT - 1] : 0;
+    for (uint8_t y = 0; y < L::HEIGHT; y++) {
+        row_t row = life.rows[y];
+        row_t below = y + 1 < L::HEIGHT ? life.rows[y + 1] : wrap ? first : 0;
+
+        row_t s[4] = {0, 0, 0, 0};
+        row_t lines[3] = {above, row, below};
+        for (uint8_t i = 0; i < 3; i++) {
+            row_t line = lines[i];
+            // the cell to the left of column x is column x - 1, so its bit is shifted up, and vice versa
+            row_t left = (row_t) (line << 1);
+            row_t right = (row_t) (line >> 1);
+            if (wrap) {
+                left |= (row_t) (line >> (L::WIDTH - 1));
+                right |= (row_t) (line << (L::WIDTH - 1));
+            }
+            count(s, left & ROW_MASK);
+            count(s, right & ROW_MASK);
+            if (i != 1) count(s, line);
+        }
+
+        row_t next = 0;
+        for (uint8_t n = 1; n <= 8; n++) {
+            if (birth & (1 << (n - 1))) next |= ~row & equals(s, n);
+            if (survival & (1 << (n - 1))) next |= row & equals(s, n);
+        }
+        next &= ROW_MASK;
+
+        changed |= next != row;
+        life.rows[y] = next;
+        above = row;
+    }
+    return changed;
+}
+
+
+void lifeInit(Adafruit_NeoPixel &leds, const uint8_t *params, uint8_t *scratch) {
+    auto &life = *reinterpret_cast<life_t *>(scratch);
+    life.lastStep = millis();
+    if (params[7]) randomSeed(params[7]);
+    if (!(params[5] & FLAG_SEED_FRAME)) {
+        seedRandom(life);
+        return;
+    }
+    for (uint8_t y = 0; y < L::HEIGHT; y++) {
+        row_t row = 0;
+        for (uint8_t x = 0; x < L::WIDTH; x++) {
+            if (leds.getPixelColor(L::xy(x, y))) row |= (row_t) 1 << x;
+        }
+        life.rows[y] = row;
+    }
+}
+
+bool lifeRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *params, uint8_t *scratch) {
+    auto &life = *reinterpret_cast<life_t *>(scratch);
+    uint8_t birth = params[0] ? params[0] : 0x04;
+    uint8_t survival = params[1] || (params[5] & FLAG_LITERAL_SURVIVAL) ? params[1] : 0x06;
+    color_t color = (params[2] | params[3] | params[4]) ? color_t(params[2], params[3], params[4]) : color_t(0, 255, 64);
+    uint16_t generationTime = (params[6] ? params[6] : 20) * 10;
+
+    if (t - life.lastStep >= generationTime) {
+        life.lastStep = t;
+        // an empty board never changes either
+        if (!step(life, birth, survival, !(params[5] & FLAG_BOUNDED))) seedRandom(life);
+    }
+
+    // dead cells fade out; the brightness of every byte of the pixel buffer scales independent of the layout
+    uint8_t *pixels = leds.getPixels();
+    for (uint16_t i = 0; i < Matrix::LED_COUNT * Matrix::BYTES_PER_PIXEL; i++) pixels[i] = scale8(pixels[i], TRAIL);
+    for (uint8_t y = 0; y < L::HEIGHT; y++) {
+        for (uint8_t x = 0; x < L::WIDTH; x++) {
+            if (life.rows[y] >> x & 1) leds.setPixelColor(L::xy(x, y), color.r, color.g, color.b);
+        }
+    }
+    return true;
+}
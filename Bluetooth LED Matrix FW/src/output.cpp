@@ -0,0 +1,296 @@
+#include "output.h"
+#include "device.h"
+#include "scheduler.h"
+#include "tables.h"
+#include "uart_serial.h"
+
+
+static uint8_t frame[Matrix::LED_COUNT * Matrix::BYTES_PER_PIXEL]; ///< The composed frame that is shown.
+
+static uint16_t overlayIndex[OVERLAY_MAX_PIXELS]; ///< The index on the strip of every LED of the overlay.
+static color_t overlayColor[OVERLAY_MAX_PIXELS]; ///< The color of every LED of the overlay.
+static uint8_t overlayAlpha[OVERLAY_MAX_PIXELS]; ///< The opacity of every LED of the overlay.
+static uint8_t overlayCount = 0; ///< The number of LEDs of the overlay.
+static blend_t overlayBlend = blend_t::ALPHA; ///< The way the overlay is blended over the base frame.
+
+static uint16_t transitionTime = TRANSITION_TIME; ///< The time of a transition in milliseconds.
+static uint32_t transitionEnd = 0; ///< The time the running transition ends.
+static uint32_t lastShow = 0; ///< The time the last frame was shown.
+static bool transition = false; ///< True while a transition is running.
+static mode_t shownMode = mode_t::OFF; ///< The mode of the frame shown last; the LEDs are black at startup.
+
+static bool staged = false; ///< True while frames are staged.
+static bool committed = false; ///< True once the staged frames have been committed.
+static uint32_t stageEnd = 0; ///< The time of the wall clock the staged frames are shown, by the commit or the timeout.
+
+static uint16_t powerLimit = POWER_LIMIT; ///< The current the LEDs may draw in milliamps, 0 for no limit.
+
+static uint8_t brightness = 255; ///< The brightness the frames are shown with.
+static uint8_t frameCount = 0; ///< The number of frames shown, wrapping around, which selects the dither thresholds.
+
+/// The difference of the dither thresholds of two consecutive channels, odd so that neighbors never flicker together.
+constexpr uint8_t DITHER_STEP = 0x65;
+
+/// The current all LEDs draw when they are black.
+constexpr uint32_t IDLE_CURRENT = (uint32_t) Matrix::LED_COUNT * LED_IDLE_CURRENT;
+
+
+state_t setOverlayBlend(uint8_t blend) {
+    if (blend > (uint8_t) blend_t::MULTIPLY) return state_t::INVALID_ARGUMENT;
+    overlayBlend = static_cast<blend_t>(blend);
+    return state_t::OK;
+}
+
+state_t setOverlayPixel(uint16_t n, const color_t &c, uint8_t alpha) {
+    if (n >= Matrix::LED_COUNT) return state_t::LED_OUT_OF_RANGE;
+    uint16_t index = MatrixLayout::index(n);
+    uint8_t i = 0;
+    while (i < overlayCount && overlayIndex[i] != index) i++;
+
+    if (alpha == 0) {
+        // keep the overlay packed by moving its last LED into the gap
+        if (i < overlayCount) {
+            overlayCount--;
+            overlayIndex[i] = overlayIndex[overlayCount];
+            overlayColor[i] = overlayColor[overlayCount];
+            overlayAlpha[i] = overlayAlpha[overlayCount];
+        }
+        return state_t::OK;
+    }
+    if (i == OVERLAY_MAX_PIXELS) return state_t::INVALID_STATE;
+    if (i == overlayCount) overlayCount++;
+    overlayIndex[i] = index;
+    overlayColor[i] = c;
+    overlayAlpha[i] = alpha;
+    return state_t::OK;
+}
+
+void clearOverlay() { overlayCount = 0; }
+
+void setTransitionTime(uint16_t time) { transitionTime = time; }
+
+uint16_t getTransitionTime() { return transitionTime; }
+
+void setPowerLimit(uint16_t limit) { powerLimit = limit; }
+
+uint16_t getPowerLimit() { return powerLimit; }
+
+void setGlobalBrightness(uint8_t value) { brightness = value; }
+
+uint8_t getGlobalBrightness() { return brightness; }
+
+void startTransition() {
+    transition = transitionTime != 0;
+    transitionEnd = millis() + transitionTime;
+    lastShow = millis();
+}
+
+void startFade(uint16_t time) {
+    shownMode = mode;
+    transition = time != 0;
+    transitionEnd = millis() + time;
+    lastShow = millis();
+}
+
+bool inTransition() { return transition; }
+
+/**
+ * @brief Get the weight of the new content of the frame composed now.
+ *
+ * The composed frame still holds the frame shown last. Moving it by the time passed since then as fraction of the
+ * time that was remaining makes the transition linear and end exactly in time, even if the content changes meanwhile.
+ *
+ * @param now The current time.
+ * @return The weight as fraction of 256, 256 if no transition is running or it ends now.
+ */
+static uint16_t transitionWeight(uint32_t now) {
+    if (!transition) return 256;
+    auto remaining = (int32_t) (transitionEnd - lastShow);
+    auto passed = (int32_t) (now - lastShow);
+    if (passed >= remaining) {
+        transition = false;
+        return 256;
+    }
+    return (uint16_t) (((uint32_t) passed << 8) / (uint32_t) remaining);
+}
+
+/**
+ * @brief Reverse the order of the bits of a byte.
+ *
+ * @param b The byte.
+ * @return The reversed byte.
+ */
+static uint8_t reverse8(uint8_t b) {
+    b = (uint8_t) ((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+    b = (uint8_t) ((b & 0xCC) >> 2 | (b & 0x33) << 2);
+    return (uint8_t) ((b & 0xAA) >> 1 | (b & 0x55) << 1);
+}
+
+/**
+ * @brief Scale a channel by the brightness, rounding by a dither threshold instead of truncating.
+ *
+ * @param v The channel.
+ * @param scale The brightness + 1, so 256 keeps the channel exactly.
+ * @param dither The threshold in 1/256 of a step.
+ * @return The scaled channel.
+ */
+static inline uint8_t dim(uint8_t v, uint16_t scale, uint8_t dither) { return (uint8_t) ((v * scale + dither) >> 8); }
+
+/**
+ * @brief Fade a channel shown last towards a new value.
+ *
+ * @param a The channel shown last.
+ * @param b The new value.
+ * @param wb The weight of the new value as fraction of 256.
+ * @return The faded channel.
+ */
+static inline uint8_t fade(uint8_t a, uint8_t b, uint16_t wb) {
+    // both weights sum up to 256, so the sum fits into 16 bits, rounded to the nearest value
+    return (uint8_t) ((a * (256 - wb) + b * wb + 128) >> 8);
+}
+
+/**
+ * @brief Scale the brightness of the composed frame down if the LEDs would draw more current than the power limit.
+ *
+ * @param sum The sum of all channels of the composed frame.
+ */
+static void limitPower(uint32_t sum) {
+    if (powerLimit == 0) return;
+    uint32_t allowed = powerLimit > IDLE_CURRENT ? (powerLimit - IDLE_CURRENT) * 255 / LED_CHANNEL_CURRENT : 0;
+    if (sum <= allowed) return;
+
+    // rounding the scale down keeps the current below the limit
+    auto scale = (uint16_t) (allowed * 256 / sum);
+    for (uint16_t i = 0; i < sizeof(frame); i++) frame[i] = (uint8_t) ((frame[i] * scale) >> 8);
+}
+
+/**
+ * @brief Compose the frame that is shown from the pixel buffer of the LED strip.
+ *
+ * The composed frame holds what the LEDs show, after the brightness has been applied. So a transition
+ * continues from the frame shown last, and the brightness is applied to the new content only.
+ * The dither threshold of every channel runs through all 256 values in 256 frames in bit-reversed order,
+ * so the average of the shown values matches the exact scaled value while the flicker stays fast.
+ * While the mode is OFF, the base frame and the overlay are composed black, so both are kept for waking up.
+ */
+static void compose() {
+    uint32_t now = millis();
+    mode_t current = mode;
+    if (current != shownMode) {
+        shownMode = current;
+        startTransition();
+    }
+    uint16_t wb = transitionWeight(now);
+    lastShow = now;
+
+    // the overlay LEDs fade from their color shown last to the overlay instead of to the base frame
+    color_t shown[OVERLAY_MAX_PIXELS];
+    for (uint8_t i = 0; i < overlayCount; i++) shown[i] = leds.getColor(frame, overlayIndex[i]);
+
+    const uint8_t *base = leds.getPixels();
+    uint16_t scale = current == mode_t::OFF ? 0 : brightness + 1;
+    uint8_t dither = reverse8(frameCount++);
+    uint32_t sum = 0;
+    if (wb == 256) {
+        for (uint16_t i = 0; i < sizeof(frame); i++, dither += DITHER_STEP) {
+            sum += frame[i] = dim(base[i], scale, dither);
+        }
+    } else {
+        for (uint16_t i = 0; i < sizeof(frame); i++, dither += DITHER_STEP) {
+            sum += frame[i] = fade(frame[i], dim(base[i], scale, dither), wb);
+        }
+    }
+
+    for (uint8_t i = 0; i < overlayCount; i++) {
+        color_t under = leds.getColor(base, overlayIndex[i]);
+        color_t top = overlayColor[i];
+        if (overlayBlend == blend_t::MULTIPLY) {
+            top = {scale8(under.r, top.r), scale8(under.g, top.g), scale8(under.b, top.b)};
+        }
+        top = color_t::lerp(under, top, overlayAlpha[i]);
+        top = {dim(top.r, scale, dither), dim(top.g, scale, dither), dim(top.b, scale, dither)};
+        if (wb != 256) top = {fade(shown[i].r, top.r, wb), fade(shown[i].g, top.g, wb), fade(shown[i].b, top.b, wb)};
+
+        color_t old = leds.getColor(frame, overlayIndex[i]);
+        sum = sum - old.r - old.g - old.b + top.r + top.g + top.b;
+        leds.setColor(frame, overlayIndex[i], top);
+    }
+    limitPower(sum);
+}
+
+void stageFrames() {
+    staged = true;
+    committed = false;
+    stageEnd = wallClock() + STAGE_TIMEOUT;
+}
+
+state_t commitFrames(uint32_t time) {
+    if (!staged || committed) return state_t::INVALID_STATE;
+    if ((int32_t) (time - wallClock()) > (int32_t) STAGE_TIMEOUT) return state_t::INVALID_ARGUMENT;
+    committed = true;
+    stageEnd = time;
+    return state_t::OK;
+}
+
+bool framesStaged() { return staged; }
+
+uint16_t stagedDelay() {
+    if (!staged) return UINT16_MAX;
+    auto remaining = (int32_t) (stageEnd - wallClock());
+    return remaining <= 0 ? 0 : remaining >= UINT16_MAX ? UINT16_MAX : (uint16_t) remaining;
+}
+
+void showFrame() {
+    if (staged) return;
+    compose();
+    leds.show(frame);
+    frameSync();
+}
+
+void updateOutput() {
+    if (staged) {
+        if (stagedDelay() != 0) return;
+        staged = false;
+        showFrame();
+        return;
+    }
+    if (mode != shownMode || (transition && millis() - lastShow >= TRANSITION_FRAME_TIME)) showFrame();
+}
+
+#ifdef BENCHMARK
+/**
+ * @brief Measure the time compose() takes and print it to the UART.
+ *
+ * @param name The name printed with the time.
+ */
+static void benchmarkCompose(const char *name) {
+    uint32_t start = micros();
+    compose();
+    uint32_t time = micros() - start;
+    uart_print("BENCHMARK COMPOSE ");
+    uart_print(name);
+    uart_print(": ");
+    uart_print(time);
+    uart_println(" US");
+}
+
+void benchmarkOutput() {
+    leds.fill(0xFFFFFF);
+    setPowerLimit(0);
+    benchmarkCompose("PLAIN");
+
+    setGlobalBrightness(64);
+    benchmarkCompose("DITHERED");
+
+    for (uint8_t i = 0; i < OVERLAY_MAX_PIXELS; i++) setOverlayPixel(i, color_t(255, 0, 0), 128);
+    setPowerLimit(POWER_LIMIT);
+    setGlobalBrightness(255);
+    transition = true;
+    transitionEnd = millis() + TRANSITION_TIME;
+    benchmarkCompose("WORST CASE");
+
+    clearOverlay();
+    leds.clear();
+    transition = false;
+}
+#endif
@@ -0,0 +1,45 @@
+#include "params.h"
+#include "config.h"
+#include "Button.hpp"
+
+/// The parameter table, indexed by the IDs of the parameters.
+static const param_info_t PARAMS[PARAM_COUNT] PROGMEM = {
+        {param_type_t::U16, 1, 1000, Matrix::DELAY},
+        {param_type_t::U8, 1, 255, 1},
+        {param_type_t::U8, 1, 255, 8},
+        {param_type_t::U8, 1, 255, Button::DEBOUNCE_TIME},
+        {param_type_t::U16, 1, 10000, Button::LONG_PRESS_TIME},
+        {param_type_t::U16, 0, 10000, Button::DOUBLE_CLICK_TIME},
+        {param_type_t::U16, 0, 10000, Button::REPEAT_TIME},
+};
+
+static uint16_t values[PARAM_COUNT]; ///< The cached values of the parameters, set to their defaults by paramsBegin().
+
+static void (*paramHook)() = nullptr; ///< The function called after the value of a parameter has been set.
+
+
+void paramsBegin() {
+    param_info_t info;
+    for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+        paramInfo(i, info);
+        values[i] = info.def;
+    }
+}
+
+uint16_t getParam(param_t id) { return values[(uint8_t) id]; }
+
+state_t setParam(uint8_t id, uint16_t value) {
+    param_info_t info;
+    if (!paramInfo(id, info) || value < info.min || value > info.max) return state_t::INVALID_ARGUMENT;
+    values[id] = value;
+    if (paramHook) paramHook();
+    return state_t::OK;
+}
+
+bool paramInfo(uint8_t id, param_info_t &info) {
+    if (id >= PARAM_COUNT) return false;
+    memcpy_P(&info, &PARAMS[id], sizeof(param_info_t));
+    return true;
+}
+
+void setParamHook(void (*hook)()) { paramHook = hook; }
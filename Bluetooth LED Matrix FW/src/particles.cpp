@@ -0,0 +1,196 @@
+#include "particles.h"
+#include "tables.h"
+
+using L = MatrixLayout;
+
+/**
+ * @struct particles_t
+ * @brief The state of the effect, kept in the scratch memory.
+ */
+struct particles_t {
+    uint8_t live; ///< The index of the first living particle, PARTICLE_NONE if there is none.
+    uint8_t free; ///< The index of the first unused particle, PARTICLE_NONE if the pool is full.
+    particle_t pool[PARTICLE_POOL_SIZE]; ///< The particles.
+};
+
+static_assert(sizeof(particles_t) <= EFFECT_SCRATCH_SIZE, "the particles must fit into the scratch memory");
+static_assert(PARTICLE_POOL_SIZE >= 8, "the scratch memory is too small for a burst of particles");
+
+constexpr uint8_t PARTICLE_FADE_FRAMES = 16; ///< The frames a particle fades out before it disappears.
+constexpr int8_t SPARK_GRAVITY = 3; ///< The acceleration of the sparks in 1/64 pixels per frame and frame.
+constexpr uint8_t SPARK_BURST = 8; ///< The number of particles of a burst of sparks.
+
+/**
+ * @enum style_t
+ * @brief The styles of the effect.
+ */
+enum class style_t : uint8_t {
+    SPARKS = 0x00,
+    CONFETTI = 0x01,
+    METEORS = 0x02,
+};
+
+/**
+ * @struct style_defaults_t
+ * @brief The defaults of the parameters of a style.
+ */
+struct style_defaults_t {
+    uint8_t rate; ///< The chance per frame out of 256 that new particles are spawned.
+    uint8_t trail; ///< The brightness the frame keeps per frame out of 256.
+};
+
+/// The defaults of the styles, indexed by their value.
+static const style_defaults_t STYLES[] PROGMEM = {
+        {24, 160},
+        {96, 208},
+        {16, 216},
+};
+
+
+/**
+ * @brief Take a particle from the free list and put it at the start of the list of living particles.
+ *
+ * @param state The state of the effect.
+ * @param x The column in 1/256 pixels.
+ * @param y The row in 1/256 pixels.
+ * @param vx The velocity to the right in 1/64 pixels per frame.
+ * @param vy The velocity downwards in 1/64 pixels per frame.
+ * @param life The frames until the particle disappears.
+ * @param c The color of the particle.
+ * @return False if the pool is full, true otherwise.
+ */
+static bool spawn(particles_t &state, int16_t x, int16_t y, int8_t vx, int8_t vy, uint8_t life, const color_t &c) {
+    uint8_t i = state.free;
+    if (i == PARTICLE_NONE) return false;
+    particle_t &p = state.pool[i];
+    state.free = p.next;
+    p = {x, y, vx, vy, life, c, state.live};
+    state.live = i;
+    return true;
+}
+
+/**
+ * @brief Add a color onto a pixel, saturating every component.
+ *
+ * @param leds The LED strip.
+ * @param x The column, skipped if outside the matrix.
+ * @param y The row, skipped if outside the matrix.
+ * @param c The color to add.
+ */
+static void addXY(Adafruit_NeoPixel &leds, int8_t x, int8_t y, const color_t &c) {
+    if (x < 0 || y < 0 || x >= L::WIDTH || y >= L::HEIGHT) return;
+    uint16_t i = L::xy((uint8_t) x, (uint8_t) y);
+    color_t p(leds.getPixelColor(i));
+    leds.setPixelColor(i, min(p.r + c.r, 255), min(p.g + c.g, 255), min(p.b + c.b, 255));
+}
+
+/**
+ * @brief Draw a particle onto the four pixels around its position, weighted by their distance.
+ *
+ * @param leds The LED strip.
+ * @param p The particle.
+ */
+static void draw(Adafruit_NeoPixel &leds, const particle_t &p) {
+    color_t c = p.life >= PARTICLE_FADE_FRAMES ? p.color : p.color.scaled(p.life * (256 / PARTICLE_FADE_FRAMES));
+    auto x = (int8_t) (p.x >> 8);
+    auto y = (int8_t) (p.y >> 8);
+    auto fx = (uint8_t) p.x;
+    auto fy = (uint8_t) p.y;
+    addXY(leds, x, y, c.scaled(scale8((uint8_t) ~fx, (uint8_t) ~fy)));
+    addXY(leds, (int8_t) (x + 1), y, c.scaled(scale8(fx, (uint8_t) ~fy)));
+    addXY(leds, x, (int8_t) (y + 1), c.scaled(scale8((uint8_t) ~fx, fy)));
+    addXY(leds, (int8_t) (x + 1), (int8_t) (y + 1), c.scaled(scale8(fx, fy)));
+}
+
+/**
+ * @brief Get a random position on an axis in 1/256 pixels.
+ *
+ * @param size The number of pixels of the axis.
+ * @return The position.
+ */
+static int16_t randomPosition(uint8_t size) { return (int16_t) random((size - 1) * 256l); }
+
+/**
+ * @brief Spawn the particles of a style.
+ *
+ * @param state The state of the effect.
+ * @param style The style.
+ * @param c The color of the particles, black selects the color of the style.
+ */
+static void spawnStyle(particles_t &state, style_t style, const color_t &c) {
+    switch (style) {
+        case style_t::SPARKS: {
+            int16_t x = randomPosition(L::WIDTH);
+            int16_t y = randomPosition((uint8_t) (L::HEIGHT * 2 / 3 + 1));
+            color_t color = c == color_t() ? color_t(255, (uint8_t) random(96, 192), 32) : c;
+            for (uint8_t i = 0; i < SPARK_BURST; i++) {
+                auto vx = (int8_t) random(-64, 65);
+                auto vy = (int8_t) random(-96, 33);
+                if (!spawn(state, x, y, vx, vy, (uint8_t) random(20, 40), color)) break;
+            }
+            break;
+        }
+        case style_t::CONFETTI: {
+            color_t color = c == color_t() ? color_t::wheel((uint8_t) random(256)) : c;
+            spawn(state, (int16_t) (random(L::WIDTH) << 8), (int16_t) (random(L::HEIGHT) << 8), 0, 0,
+                  (uint8_t) random(24, 48), color);
+            break;
+        }
+        case style_t::METEORS: {
+            color_t color = c == color_t() ? color_t(160, 200, 255) : c;
+            spawn(state, randomPosition(L::WIDTH), 0, (int8_t) random(-24, 25), (int8_t) random(24, 48), 255, color);
+            break;
+        }
+    }
+}
+
+void particlesInit(Adafruit_NeoPixel &, const uint8_t *, uint8_t *scratch) {
+    auto &state = *reinterpret_cast<particles_t *>(scratch);
+    state.live = PARTICLE_NONE;
+    state.free = 0;
+    for (uint8_t i = 0; i < PARTICLE_POOL_SIZE; i++) state.pool[i].next = i + 1;
+    state.pool[PARTICLE_POOL_SIZE - 1].next = PARTICLE_NONE;
+}
+
+bool particlesRender(Adafruit_NeoPixel &leds, uint32_t, const uint8_t *params, uint8_t *scratch) {
+    auto &state = *reinterpret_cast<particles_t *>(scratch);
+    auto style = static_cast<style_t>(params[0] <= (uint8_t) style_t::METEORS ? params[0] : 0);
+    style_defaults_t defaults;
+    memcpy_P(&defaults, &STYLES[(uint8_t) style], sizeof(style_defaults_t));
+    uint8_t rate = params[4] ? params[4] : defaults.rate;
+    uint8_t trail = params[5] ? params[5] : defaults.trail;
+
+    // fade the trails; the brightness of every byte of the pixel buffer scales independent of the layout
+    uint8_t *pixels = leds.getPixels();
+    for (uint16_t i = 0; i < Matrix::LED_COUNT * Matrix::BYTES_PER_PIXEL; i++) pixels[i] = scale8(pixels[i], trail);
+
+    if (random(256) < rate) spawnStyle(state, style, color_t(params[1], params[2], params[3]));
+
+    // move the living particles, returning the ones that disappear or leave the matrix to the free list
+    uint8_t *link = &state.live;
+    while (*link != PARTICLE_NONE) {
+        uint8_t i = *link;
+        particle_t &p = state.pool[i];
+        p.x = (int16_t) (p.x + p.vx * 4);
+        p.y = (int16_t) (p.y + p.vy * 4);
+        if (style == style_t::SPARKS) p.vy = (int8_t) min(p.vy + SPARK_GRAVITY, 127);
+        bool outside = p.x < -256 || p.x >= L::WIDTH * 256 || p.y >= L::HEIGHT * 256 || p.y < -L::HEIGHT * 256;
+        if (--p.life == 0 || outside) {
+            *link = p.next;
+            p.next = state.free;
+            state.free = i;
+            continue;
+        }
+        draw(leds, p);
+        link = &p.next;
+    }
+    return true;
+}
+
+#ifdef BENCHMARK
+void particlesFill(uint8_t *scratch) {
+    auto &state = *reinterpret_cast<particles_t *>(scratch);
+    for (uint8_t i = 0; spawn(state, (int16_t) (i % L::WIDTH * 256 + 128), (int16_t) (i / L::WIDTH % L::HEIGHT * 256),
+                              1, 1, 255, color_t(255, 255, 255)); i++);
+}
+#endif
@@ -0,0 +1,203 @@
+#include "persist.h"
+#include "storage.h"
+#include "device.h"
+#include "effects.h"
+#include "output.h"
+#include "params.h"
+
+/**
+ * @struct record_t
+ * @brief A persisted state.
+ */
+struct record_t {
+    uint8_t seq; ///< The sequence number, one more than the one of the record written before.
+    uint8_t mode; ///< The mode of operation, EFFECT or BT.
+    uint8_t flags; ///< FRAME_STORED if the frame has been written with the record.
+    uint8_t effect; ///< The ID of the selected effect.
+    uint8_t params[EFFECT_MAX_PARAMS]; ///< The parameters of the selected effect.
+    uint8_t brightness; ///< The brightness the frames are shown with.
+    uint8_t check; ///< The checksum of all other bytes of the record.
+    uint16_t transitionTime; ///< The time of the transitions in milliseconds.
+    uint16_t powerLimit; ///< The current the LEDs may draw in milliamps.
+    uint16_t tunables[PARAM_COUNT]; ///< The values of the parameters of params.h.
+    uint16_t frameCheck; ///< The checksum of the frame if it has been written with the record.
+};
+
+constexpr uint8_t STATE_SLOTS = STATE_SIZE / sizeof(record_t); ///< The number of records of the ring.
+constexpr uint8_t FRAME_STORED = 0x01; ///< The flag of a record whose frame has been written.
+
+static_assert(STATE_SLOTS >= 4, "the ring must hold enough records to spread the wear");
+
+/**
+ * @enum phase_t
+ * @brief The phases of writing a state.
+ */
+enum class phase_t : uint8_t {
+    IDLE, ///< Taking snapshots until a changed state has been unchanged for PERSIST_DELAY.
+    FRAME, ///< Writing the frame.
+    RECORD, ///< Writing the record.
+};
+
+static record_t pending = {}; ///< The last snapshot of the state.
+static record_t written = {}; ///< The state written last.
+static record_t out = {}; ///< The record being written, with its sequence number and checksum.
+static uint32_t changedAt = 0; ///< The time the state has changed last.
+static phase_t phase = phase_t::IDLE; ///< The phase of writing the state.
+static uint16_t position = 0; ///< The offset of the next byte written in the frame or the record.
+static uint8_t newest = STATE_SLOTS - 1; ///< The slot of the newest record, the next one is written after it.
+static uint8_t seq = 0; ///< The sequence number of the newest record.
+
+
+/**
+ * @brief Get the checksum of a record, seeded with the number of LEDs, so records of other builds are invalid.
+ *
+ * @param r The record.
+ * @return The checksum.
+ */
+static uint8_t recordCheck(const record_t &r) {
+    auto bytes = reinterpret_cast<const uint8_t *>(&r);
+    auto sum = (uint8_t) (0x5A ^ (uint8_t) Matrix::LED_COUNT);
+    for (uint8_t i = 0; i < sizeof(record_t); i++) {
+        if (i != offsetof(record_t, check)) sum += bytes[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief Get the checksum of a frame, see checksumAdd().
+ *
+ * @param frame The frame, nullptr to read the persisted frame from the EEPROM.
+ * @return The checksum.
+ */
+static uint16_t frameCheck(const uint8_t *frame) {
+    uint16_t sum = 0;
+    for (uint16_t i = 0; i < FRAME_SIZE; i++) {
+        uint8_t b = frame ? frame[i] : eeprom_read_byte(eepromPtr(FRAME_ADDR + i));
+        sum = checksumAdd(sum, b);
+    }
+    return sum;
+}
+
+/**
+ * @brief Take a snapshot of the state, without sequence number and checksum.
+ *
+ * @param r Set to the snapshot.
+ */
+static void snapshot(record_t &r) {
+    r = {};
+    mode_t current = mode;
+    // the device is turned on again in the mode it has been turned off in
+    r.mode = current == mode_t::OFF ? pending.mode : (uint8_t) current;
+    r.effect = selectedEffect();
+    memcpy(r.params, effectParams(), EFFECT_MAX_PARAMS);
+    r.brightness = getGlobalBrightness();
+    r.transitionTime = getTransitionTime();
+    r.powerLimit = getPowerLimit();
+    for (uint8_t i = 0; i < PARAM_COUNT; i++) r.tunables[i] = getParam((param_t) i);
+    if (r.mode == (uint8_t) mode_t::BT) {
+        r.flags = FRAME_STORED;
+        r.frameCheck = frameCheck(leds.getPixels());
+    }
+}
+
+/**
+ * @brief Write the next changed byte of a region if the EEPROM is ready.
+ *
+ * @param addr The address of the region.
+ * @param data The data of the region.
+ * @param size The size of the region.
+ * @return True once all bytes of the region have been written.
+ */
+static bool writeNext(uint16_t addr, const uint8_t *data, uint16_t size) {
+    if (!eeprom_is_ready()) return false;
+    while (position < size) {
+        uint8_t *cell = eepromPtr(addr + position);
+        uint8_t b = data[position++];
+        if (eeprom_read_byte(cell) != b) {
+            eeprom_write_byte(cell, b);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool restoreState() {
+    record_t best = {};
+    bool found = false;
+    for (uint8_t i = 0; i < STATE_SLOTS; i++) {
+        record_t r;
+        eeprom_read_block(&r, eepromPtr(STATE_ADDR + i * sizeof(record_t)), sizeof(record_t));
+        if (r.check != recordCheck(r)) continue;
+        if (found && (int8_t) (r.seq - best.seq) <= 0) continue;
+        best = r;
+        newest = i;
+        seq = r.seq;
+        found = true;
+    }
+
+    if (found) {
+        setGlobalBrightness(best.brightness);
+        setTransitionTime(best.transitionTime);
+        setPowerLimit(best.powerLimit);
+        for (uint8_t i = 0; i < PARAM_COUNT; i++) setParam(i, best.tunables[i]);
+        selectEffect(best.effect, best.params, EFFECT_MAX_PARAMS);
+        mode = mode_t::EFFECT;
+        if (best.mode == (uint8_t) mode_t::BT && (best.flags & FRAME_STORED) && frameCheck(nullptr) == best.frameCheck) {
+            eeprom_read_block(leds.getPixels(), eepromPtr(FRAME_ADDR), FRAME_SIZE);
+            mode = mode_t::BT;
+        }
+    }
+    // the restored state needs no write, a state that could not be restored completely is written again
+    pending.mode = (uint8_t) mode;
+    snapshot(pending);
+    written = pending;
+    if (found && best.mode != pending.mode) written.mode = best.mode;
+    return found;
+}
+
+uint16_t persistUpdate() {
+    switch (phase) {
+        case phase_t::IDLE: {
+            record_t now;
+            snapshot(now);
+            if (memcmp(&now, &pending, sizeof(record_t)) != 0) {
+                pending = now;
+                changedAt = millis();
+            } else if (memcmp(&pending, &written, sizeof(record_t)) != 0 && millis() - changedAt >= PERSIST_DELAY) {
+                phase = pending.flags & FRAME_STORED ? phase_t::FRAME : phase_t::RECORD;
+                position = 0;
+                out = pending;
+                out.seq = (uint8_t) (seq + 1);
+                out.check = recordCheck(out);
+                return 0;
+            }
+            return PERSIST_CHECK_TIME;
+        }
+        case phase_t::FRAME: {
+            if (!writeNext(FRAME_ADDR, leds.getPixels(), FRAME_SIZE)) return 1;
+            // a frame changed while it was written is written again once it is unchanged
+            if (frameCheck(leds.getPixels()) != out.frameCheck) {
+                phase = phase_t::IDLE;
+                return PERSIST_CHECK_TIME;
+            }
+            phase = phase_t::RECORD;
+            position = 0;
+            return 0;
+        }
+        case phase_t::RECORD: {
+            uint8_t slot = (uint8_t) ((newest + 1) % STATE_SLOTS);
+            auto bytes = reinterpret_cast<const uint8_t *>(&out);
+            if (!writeNext(STATE_ADDR + slot * sizeof(record_t), bytes, sizeof(record_t))) return 1;
+            newest = slot;
+            seq = out.seq;
+            written = out;
+            written.seq = 0;
+            written.check = 0;
+            phase = phase_t::IDLE;
+            return PERSIST_CHECK_TIME;
+        }
+    }
+    return PERSIST_CHECK_TIME;
+}
+
+bool persistIdle() { return phase == phase_t::IDLE && memcmp(&pending, &written, sizeof(record_t)) == 0; }
@@ -0,0 +1,274 @@
+#include <string.h>
+#include "render.h"
+
+using L = MatrixLayout;
+constexpr uint8_t BYTES_PER_PIXEL = Matrix::BYTES_PER_PIXEL;
+/// The largest squared distance between two LEDs of the matrix.
+constexpr uint32_t MAX_DIST2 = (uint32_t) (L::WIDTH - 1) * (L::WIDTH - 1) + (uint32_t) (L::HEIGHT - 1) * (L::HEIGHT - 1);
+/// The shift of the squared distances of a radial gradient, so they still fit into 32 bits when scaled by 255 * 255.
+constexpr uint8_t RADIAL_SHIFT = MAX_DIST2 > UINT32_MAX / 65025 ? 1 : 0;
+
+static_assert((MAX_DIST2 >> RADIAL_SHIFT) <= UINT32_MAX / 65025, "the squared distances of a radial gradient overflow");
+
+
+/**
+ * @brief Calculate the integer square root of a value.
+ *
+ * @param value The value to calculate the square root of.
+ * @return The largest integer whose square is not greater than the value.
+ */
+static uint16_t isqrt(uint32_t value) {
+    uint32_t result = 0;
+    uint32_t one = 1UL << 30;
+    while (one > value) one >>= 2;
+    while (one != 0) {
+        if (value >= result + one) {
+            value -= result + one;
+            result = (result >> 1) + one;
+        } else {
+            result >>= 1;
+        }
+        one >>= 2;
+    }
+    return (uint16_t) result;
+}
+
+/**
+ * @brief Get the color of a gradient at a specific position.
+ *
+ * @param stops The color stops, sorted by their position.
+ * @param count The number of color stops.
+ * @param t The position along the gradient in the range [0, 255].
+ * @return The interpolated color.
+ */
+static color_t gradientColor(const gradient_stop_t *stops, uint8_t count, uint8_t t) {
+    if (t <= stops[0].pos) return stops[0].color;
+    for (uint8_t i = 1; i < count; i++) {
+        if (t > stops[i].pos) continue;
+        uint8_t span = stops[i].pos - stops[i - 1].pos;
+        if (span == 0) return stops[i].color;
+        auto local = (uint8_t) ((uint16_t) (t - stops[i - 1].pos) * 255 / span);
+        return color_t::lerp(stops[i - 1].color, stops[i].color, local);
+    }
+    return stops[count - 1].color;
+}
+
+/**
+ * @brief Swap two pixels in a pixel buffer.
+ *
+ * @param pixels The pixel buffer.
+ * @param a The index of the first pixel.
+ * @param b The index of the second pixel.
+ */
+static void swapPixels(uint8_t *pixels, uint16_t a, uint16_t b) {
+    uint8_t *pa = pixels + a * BYTES_PER_PIXEL;
+    uint8_t *pb = pixels + b * BYTES_PER_PIXEL;
+    for (uint8_t i = 0; i < BYTES_PER_PIXEL; i++) {
+        uint8_t tmp = pa[i];
+        pa[i] = pb[i];
+        pb[i] = tmp;
+    }
+}
+
+/**
+ * @brief Reverse the order of a contiguous range of pixels in a pixel buffer.
+ *
+ * @param pixels The pixel buffer.
+ * @param first The index of the first pixel of the range.
+ * @param last The index of the last pixel of the range.
+ */
+static void reversePixels(uint8_t *pixels, uint16_t first, uint16_t last) {
+    while (first < last) swapPixels(pixels, first++, last--);
+}
+
+/**
+ * @brief Rotate a contiguous range of pixels in a pixel buffer towards higher indices without a temporary buffer.
+ *
+ * @param pixels The first pixel of the range.
+ * @param count The number of pixels in the range.
+ * @param by The number of pixels to rotate by. Must be less than count.
+ */
+static void rotatePixels(uint8_t *pixels, uint16_t count, uint16_t by) {
+    if (by == 0) return;
+    reversePixels(pixels, 0, count - 1);
+    reversePixels(pixels, 0, by - 1);
+    reversePixels(pixels, by, count - 1);
+}
+
+/**
+ * @brief Move the pixels of a contiguous range in a pixel buffer, filling the vacated pixels.
+ *
+ * @param leds The LED strip owning the pixel buffer.
+ * @param first The index of the first pixel of the range.
+ * @param count The number of pixels in the range.
+ * @param by The number of pixels to move towards higher (positive) or lower (negative) indices.
+ * @param wrap True if the moved out pixels wrap around, false if the vacated pixels are filled.
+ * @param fill The color of the vacated pixels.
+ */
+static void movePixels(Adafruit_NeoPixel &leds, uint16_t first, uint16_t count, int16_t by, bool wrap, const color_t &fill) {
+    uint8_t *pixels = leds.getPixels() + first * BYTES_PER_PIXEL;
+    auto n = (uint16_t) abs(by);
+    if (wrap) {
+        n %= count;
+        rotatePixels(pixels, count, by > 0 ? n : (count - n) % count);
+        return;
+    }
+    if (n > count) n = count;
+    uint16_t bytes = (count - n) * BYTES_PER_PIXEL;
+    if (by > 0) memmove(pixels + n * BYTES_PER_PIXEL, pixels, bytes);
+    else memmove(pixels, pixels + n * BYTES_PER_PIXEL, bytes);
+    leds.fill(Adafruit_NeoPixel::Color(fill.r, fill.g, fill.b), by > 0 ? first : first + count - n, n);
+}
+
+/**
+ * @brief Move the pixels of a logical row or column one by one through the layout mapping.
+ *
+ * This is the fallback for layouts whose logical rows are not contiguous on the strip.
+ *
+ * @param leds The LED strip owning the pixel buffer.
+ * @param column True to move the pixels of a column, false to move the pixels of a row.
+ * @param line The index of the row or column.
+ * @param by The number of pixels to move towards higher (positive) or lower (negative) coordinates.
+ * @param wrap True if the moved out pixels wrap around, false if the vacated pixels are filled.
+ * @param fill The color of the vacated pixels.
+ */
+static void moveLine(Adafruit_NeoPixel &leds, bool column, uint8_t line, int8_t by, bool wrap, const color_t &fill) {
+    uint8_t *pixels = leds.getPixels();
+    uint8_t length = column ? L::HEIGHT : L::WIDTH;
+    auto at = [column, line](uint8_t pos) { return column ? L::xy(line, pos) : L::xy(pos, line); };
+    auto reverse = [&](uint8_t first, uint8_t last) { while (first < last) swapPixels(pixels, at(first++), at(last--)); };
+    auto n = (uint8_t) abs(by);
+    if (wrap) {
+        n %= length;
+        uint8_t r = by > 0 ? n : (length - n) % length;
+        if (r == 0) return;
+        reverse(0, length - 1);
+        reverse(0, r - 1);
+        reverse(r, length - 1);
+        return;
+    }
+    if (n > length) n = length;
+    for (uint8_t i = 0; i < length; i++) {
+        // iterate against the direction of the movement, like memmove does for overlapping ranges
+        uint8_t to = by > 0 ? length - 1 - i : i;
+        uint16_t dst = at(to);
+        if (i < length - n) {
+            memcpy(pixels + dst * BYTES_PER_PIXEL, pixels + at(by > 0 ? to - n : to + n) * BYTES_PER_PIXEL, BYTES_PER_PIXEL);
+        } else {
+            leds.setPixelColor(dst, fill.r, fill.g, fill.b);
+        }
+    }
+}
+
+
+bool renderGradient(Adafruit_NeoPixel &leds, gradient_t kind, uint8_t a, uint8_t b, const gradient_stop_t *stops, uint8_t count) {
+    if (count < GRADIENT_MIN_STOPS || count > GRADIENT_MAX_STOPS) return false;
+    for (uint8_t i = 1; i < count; i++) {
+        if (stops[i].pos < stops[i - 1].pos) return false;
+    }
+
+    switch (kind) {
+        case gradient_t::LINEAR: {
+            auto dx = (int8_t) a;
+            auto dy = (int8_t) b;
+            if (dx == 0 && dy == 0) return false;
+            // the projection onto the direction vector is extremal at the corners of the matrix
+            int16_t px = (int16_t) (L::WIDTH - 1) * dx;
+            int16_t py = (int16_t) (L::HEIGHT - 1) * dy;
+            int16_t pMin = min(px, (int16_t) 0) + min(py, (int16_t) 0);
+            auto range = (uint16_t) (max(px, (int16_t) 0) + max(py, (int16_t) 0) - pMin);
+            for (uint8_t y = 0; y < L::HEIGHT; y++) {
+                for (uint8_t x = 0; x < L::WIDTH; x++) {
+                    auto p = (uint16_t) ((int16_t) x * dx + (int16_t) y * dy - pMin);
+                    auto t = range ? (uint8_t) ((uint32_t) p * 255 / range) : 0;
+                    auto c = gradientColor(stops, count, t);
+                    leds.setPixelColor(L::xy(x, y), c.r, c.g, c.b);
+                }
+            }
+            return true;
+        }
+        case gradient_t::RADIAL: {
+            if (a >= L::WIDTH || b >= L::HEIGHT) return false;
+            // the corner farthest away from the center marks the end of the gradient
+            uint32_t mx = max(a, (uint8_t) (L::WIDTH - 1 - a));
+            uint32_t my = max(b, (uint8_t) (L::HEIGHT - 1 - b));
+            uint32_t maxDist2 = (mx * mx + my * my) >> RADIAL_SHIFT;
+            for (uint8_t y = 0; y < L::HEIGHT; y++) {
+                for (uint8_t x = 0; x < L::WIDTH; x++) {
+                    int16_t dx = (int16_t) x - a;
+                    int16_t dy = (int16_t) y - b;
+                    uint32_t dist2 = ((uint32_t) ((int32_t) dx * dx) + (uint32_t) ((int32_t) dy * dy)) >> RADIAL_SHIFT;
+                    auto t = maxDist2 ? (uint8_t) isqrt(dist2 * 65025 / maxDist2) : 0;
+                    auto c = gradientColor(stops, count, t);
+                    leds.setPixelColor(L::xy(x, y), c.r, c.g, c.b);
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool renderPattern(Adafruit_NeoPixel &leds, pattern_t kind, uint8_t size, const color_t &c1, const color_t &c2) {
+    if (size == 0) return false;
+    if (kind != pattern_t::CHECKER && kind != pattern_t::STRIPES_VERTICAL &&
+        kind != pattern_t::STRIPES_HORIZONTAL && kind != pattern_t::RINGS)
+        return false;
+
+    for (uint8_t y = 0; y < L::HEIGHT; y++) {
+        for (uint8_t x = 0; x < L::WIDTH; x++) {
+            uint8_t cell = 0;
+            switch (kind) {
+                case pattern_t::CHECKER:
+                    cell = x / size + y / size;
+                    break;
+                case pattern_t::STRIPES_VERTICAL:
+                    cell = x / size;
+                    break;
+                case pattern_t::STRIPES_HORIZONTAL:
+                    cell = y / size;
+                    break;
+                case pattern_t::RINGS: {
+                    // distances are calculated in half pixels, as the center may lie between two pixels
+                    int16_t dx = 2 * x - (L::WIDTH - 1);
+                    int16_t dy = 2 * y - (L::HEIGHT - 1);
+                    cell = isqrt((uint32_t) ((int32_t) dx * dx) + (uint32_t) ((int32_t) dy * dy)) / 2 / size;
+                    break;
+                }
+            }
+            const auto &c = (cell & 1) ? c2 : c1;
+            leds.setPixelColor(L::xy(x, y), c.r, c.g, c.b);
+        }
+    }
+    return true;
+}
+
+void shiftPixels(Adafruit_NeoPixel &leds, int8_t dx, int8_t dy, bool wrap, const color_t &fill) {
+    if (!L::ROWS_CONTIGUOUS) {
+        if (dx != 0) for (uint8_t y = 0; y < L::HEIGHT; y++) moveLine(leds, false, y, dx, wrap, fill);
+        if (dy != 0) for (uint8_t x = 0; x < L::WIDTH; x++) moveLine(leds, true, x, dy, wrap, fill);
+        return;
+    }
+
+    if (dx != 0) {
+        for (uint8_t y = 0; y < L::HEIGHT; y++) {
+            movePixels(leds, L::rowStart(y), L::WIDTH, L::rowReversed(y) ? -dx : dx, wrap, fill);
+        }
+    }
+
+    if (dy != 0) {
+        auto n = (uint8_t) abs(dy);
+        if (wrap) n %= L::HEIGHT;
+        if (n == 0) return;
+        movePixels(leds, 0, L::COUNT, (int16_t) (L::rowsReversed() ? -dy : dy) * L::WIDTH, wrap, fill);
+        // rows moved onto a row of the opposite direction (serpentine wiring) have to be mirrored
+        if (n >= L::HEIGHT) return;
+        uint8_t first = wrap || dy < 0 ? 0 : n;
+        uint8_t last = wrap || dy > 0 ? L::HEIGHT : L::HEIGHT - n;
+        for (uint8_t y = first; y < last; y++) {
+            auto from = (uint8_t) ((y + L::HEIGHT - (dy > 0 ? n : L::HEIGHT - n)) % L::HEIGHT);
+            if (L::rowReversed(y) == L::rowReversed(from)) continue;
+            reversePixels(leds.getPixels(), L::rowStart(y), L::rowStart(y) + L::WIDTH - 1);
+        }
+    }
+}
@@ -0,0 +1,164 @@
+#include "scenes.h"
+#include "color.h"
+#include "device.h"
+#include "output.h"
+
+constexpr uint8_t PALETTE_OFFSET = 1; ///< The offset of the palette in a scene.
+constexpr uint8_t INDEX_OFFSET = PALETTE_OFFSET + SCENE_MAX_COLORS * 3; ///< The offset of the palette indices.
+constexpr uint16_t CHECK_OFFSET = SCENE_SIZE - 2; ///< The offset of the checksum.
+
+static uint8_t ramScenes[SCENE_RAM_SLOTS][SCENE_SIZE]; ///< The slots in the SRAM, all empty at startup.
+
+static color_t palette[SCENE_MAX_COLORS]; ///< The palette of the scene being stored.
+static uint8_t paletteSize = 0; ///< The number of colors of the palette.
+static uint8_t storeSlot = 0; ///< The slot in the EEPROM the scene is stored into.
+static uint16_t storeNext = SCENE_SIZE; ///< The offset of the next byte stored, SCENE_SIZE while none is stored.
+static uint16_t storeCheck = 0; ///< The checksum of the scene being stored.
+
+
+/**
+ * @brief Collect the colors of the pixel buffer into the palette, in the order of their first LED.
+ *
+ * @return False if there are more than SCENE_MAX_COLORS colors, true otherwise.
+ */
+static bool collectPalette() {
+    const uint8_t *pixels = leds.getPixels();
+    paletteSize = 0;
+    for (uint16_t i = 0; i < Matrix::LED_COUNT; i++) {
+        color_t c = leds.getColor(pixels, i);
+        uint8_t k = 0;
+        while (k < paletteSize && !(palette[k] == c)) k++;
+        if (k < paletteSize) continue;
+        if (paletteSize == SCENE_MAX_COLORS) return false;
+        palette[paletteSize++] = c;
+    }
+    return true;
+}
+
+/**
+ * @brief Get the palette index of a LED of the pixel buffer.
+ *
+ * @param i The index of the LED on the strip, LED_COUNT for the missing LED of an odd count.
+ * @return The palette index.
+ */
+static uint8_t paletteIndex(uint16_t i) {
+    if (i >= Matrix::LED_COUNT) return 0;
+    color_t c = leds.getColor(leds.getPixels(), i);
+    uint8_t k = 0;
+    while (k < paletteSize - 1 && !(palette[k] == c)) k++;
+    return k;
+}
+
+/**
+ * @brief Encode a byte of the pixel buffer as scene, except for the checksum.
+ *
+ * @param offset The offset of the byte in the scene.
+ * @return The byte.
+ */
+static uint8_t encode(uint16_t offset) {
+    if (offset < PALETTE_OFFSET) return paletteSize;
+    if (offset < INDEX_OFFSET) {
+        uint8_t k = (offset - PALETTE_OFFSET) / 3;
+        if (k >= paletteSize) return 0;
+        const color_t &c = palette[k];
+        switch ((offset - PALETTE_OFFSET) % 3) {
+            case 0:
+                return c.r;
+            case 1:
+                return c.g;
+            default:
+                return c.b;
+        }
+    }
+    uint16_t i = (offset - INDEX_OFFSET) * 2;
+    return (uint8_t) (paletteIndex(i) << 4 | paletteIndex(i + 1));
+}
+
+/**
+ * @brief Read a byte of a scene.
+ *
+ * @param slot The number of the slot, which must exist.
+ * @param offset The offset of the byte in the scene.
+ * @return The byte.
+ */
+static uint8_t readScene(uint8_t slot, uint16_t offset) {
+    if (slot & SCENE_RAM) return ramScenes[slot & ~SCENE_RAM][offset];
+    return eeprom_read_byte(eepromPtr(SCENE_ADDR + slot * SCENE_SIZE + offset));
+}
+
+/**
+ * @brief Check whether a slot exists.
+ *
+ * @param slot The number of the slot.
+ * @return True if the slot is in the EEPROM or the SRAM, false otherwise.
+ */
+static bool validSlot(uint8_t slot) {
+    return slot & SCENE_RAM ? (uint8_t) (slot & ~SCENE_RAM) < SCENE_RAM_SLOTS : slot < SCENE_SLOTS;
+}
+
+state_t storeScene(uint8_t slot) {
+    if (!validSlot(slot)) return state_t::INVALID_ARGUMENT;
+    if (storingScene() || !collectPalette()) return state_t::INVALID_STATE;
+
+    uint16_t check = 0;
+    for (uint16_t offset = 0; offset < CHECK_OFFSET; offset++) {
+        uint8_t b = encode(offset);
+        check = checksumAdd(check, b);
+        if (slot & SCENE_RAM) ramScenes[slot & ~SCENE_RAM][offset] = b;
+    }
+    if (slot & SCENE_RAM) {
+        ramScenes[slot & ~SCENE_RAM][CHECK_OFFSET] = (uint8_t) (check >> 8);
+        ramScenes[slot & ~SCENE_RAM][CHECK_OFFSET + 1] = (uint8_t) check;
+        return state_t::OK;
+    }
+    storeSlot = slot;
+    storeCheck = check;
+    storeNext = 0;
+    return state_t::OK;
+}
+
+bool storeSceneNext() {
+    if (!eeprom_is_ready()) return false;
+    // the bytes are encoded as they are written, so the scene takes no buffer, and only changed bytes are written
+    while (storeNext < SCENE_SIZE) {
+        uint8_t *cell = eepromPtr(SCENE_ADDR + storeSlot * SCENE_SIZE + storeNext);
+        uint8_t b = storeNext < CHECK_OFFSET ? encode(storeNext)
+                                             : (uint8_t) (storeNext == CHECK_OFFSET ? storeCheck >> 8 : storeCheck);
+        storeNext++;
+        if (eeprom_read_byte(cell) != b) {
+            eeprom_write_byte(cell, b);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool storingScene() { return storeNext < SCENE_SIZE; }
+
+state_t recallScene(uint8_t slot, uint16_t fade) {
+    if (!validSlot(slot)) return state_t::INVALID_ARGUMENT;
+    if (storingScene() && slot == storeSlot) return state_t::INVALID_STATE;
+
+    uint8_t colors = readScene(slot, 0);
+    if (colors == 0 || colors > SCENE_MAX_COLORS) return state_t::INVALID_STATE;
+    uint16_t check = 0;
+    for (uint16_t offset = 0; offset < CHECK_OFFSET; offset++) check = checksumAdd(check, readScene(slot, offset));
+    if (check != (uint16_t) (readScene(slot, CHECK_OFFSET) << 8 | readScene(slot, CHECK_OFFSET + 1))) {
+        return state_t::INVALID_STATE;
+    }
+
+    color_t table[SCENE_MAX_COLORS];
+    for (uint8_t k = 0; k < colors; k++) {
+        uint8_t offset = PALETTE_OFFSET + k * 3;
+        table[k] = {readScene(slot, offset), readScene(slot, offset + 1), readScene(slot, offset + 2)};
+    }
+    uint8_t *pixels = leds.getPixels();
+    for (uint16_t i = 0; i < Matrix::LED_COUNT; i++) {
+        uint8_t packed = readScene(slot, INDEX_OFFSET + i / 2);
+        uint8_t k = i % 2 ? packed & 0x0F : packed >> 4;
+        leds.setColor(pixels, i, table[k < colors ? k : 0]);
+    }
+    mode = mode_t::BT;
+    startFade(fade);
+    return state_t::OK;
+}
@@ -0,0 +1,145 @@
+#include "scheduler.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <LowPower.h>
+
+/// The compare value of Timer1 with a prescaler of 64 for a tick of SCHEDULER_TICK microseconds.
+constexpr uint16_t TIMER1_TOP = F_CPU / 64 * SCHEDULER_TICK / 1000000ul - 1;
+/// The time of a count of Timer1 with a prescaler of 64 in microseconds.
+constexpr uint8_t TIMER1_COUNT_TIME = 64 / (F_CPU / 1000000ul);
+
+static volatile uint16_t tickCount = 0; ///< The number of ticks, counted by the interrupt of Timer1.
+static void (*volatile tickHook)() = nullptr; ///< The function called from the interrupt of every tick.
+
+static const task_t *taskTable = nullptr; ///< The task table in the flash memory.
+static uint8_t tableSize = 0; ///< The number of tasks of the table.
+static uint16_t due[SCHEDULER_MAX_TASKS]; ///< The tick every task is due next.
+static task_stats_t stats[SCHEDULER_MAX_TASKS]; ///< The runtime accounting of every task.
+
+static void (*frameHook)() = nullptr; ///< The function called whenever a frame has been shown.
+static uint16_t frames = 0; ///< The number of frames shown since the last reset.
+static uint32_t idleSum = 0; ///< The time spent asleep since the last reset in microseconds.
+static uint16_t wakeMax = 0; ///< The longest wake latency from a tick since the last reset in microseconds.
+static uint16_t firstFrame = 0; ///< The time from the start to the first frame shown in milliseconds, 0 for none yet.
+static uint32_t clockOffset = 0; ///< The offset of the wall clock from millis().
+static uint16_t firstCommand = 0; ///< The time from the start to the first command executed in milliseconds, 0 for none yet.
+
+
+/**
+ * @brief Get the time since the start of the firmware as recorded for the boot.
+ *
+ * @return The time in milliseconds, saturating, at least 1.
+ */
+static uint16_t bootTime() {
+    uint32_t now = millis();
+    return now == 0 ? 1 : now > UINT16_MAX ? UINT16_MAX : (uint16_t) now;
+}
+
+
+ISR(TIMER1_COMPA_vect) {
+    tickCount++;
+    if (tickHook) tickHook();
+}
+
+void schedulerBegin(const task_t *tasks, uint8_t count) {
+    taskTable = tasks;
+    tableSize = min(count, SCHEDULER_MAX_TASKS);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        TCCR1A = 0;
+        TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10); // clear the timer on compare match, prescaler 64
+        OCR1A = TIMER1_TOP;
+        TCNT1 = 0;
+        TIMSK1 = _BV(OCIE1A);
+        tickCount = 0;
+    }
+    for (uint8_t i = 0; i < tableSize; i++) due[i] = 0;
+    resetTaskStats();
+}
+
+uint16_t ticks() {
+    uint16_t t;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) t = tickCount;
+    return t;
+}
+
+bool schedule() {
+    uint16_t now = ticks();
+    for (uint8_t i = 0; i < tableSize; i++) {
+        // the difference wraps around with the ticks, so a task is due for half of their range after its tick
+        auto lateness = (int16_t) (now - due[i]);
+        if (lateness < 0) continue;
+
+        task_t task;
+        memcpy_P(&task, &taskTable[i], sizeof(task_t));
+        task_stats_t &s = stats[i];
+        if (lateness > task.deadline) s.late++;
+
+        uint32_t start = micros();
+        uint16_t next = task.run();
+        uint32_t time = micros() - start;
+        s.runs++;
+        s.time += time;
+        if (time > s.maxTime) s.maxTime = (uint16_t) min(time, (uint32_t) UINT16_MAX);
+
+        // keep the period without drift, unless the task has fallen behind by more than one period
+        due[i] += next;
+        now = ticks();
+        if ((int16_t) (due[i] - now) <= 0) due[i] = now + next;
+        return true;
+    }
+    return false;
+}
+
+void idle() {
+    uint16_t before = ticks();
+    uint32_t start = micros();
+#if defined(__AVR_ATmega2560__)
+    LowPower.idle(SLEEP_FOREVER, ADC_OFF, TIMER5_OFF, TIMER4_OFF, TIMER3_OFF, TIMER2_OFF, TIMER1_ON, TIMER0_ON,
+                  SPI_OFF, USART3_OFF, USART2_OFF, USART1_OFF, USART0_ON, TWI_OFF);
+#else
+    LowPower.idle(SLEEP_FOREVER, ADC_OFF, TIMER2_OFF, TIMER1_ON, TIMER0_ON, SPI_OFF, USART0_ON, TWI_OFF);
+#endif
+    // Timer1 counts on from the tick, so its count is the latency if the tick has woken the MCU
+    uint16_t latency = TCNT1 * TIMER1_COUNT_TIME;
+    idleSum += micros() - start;
+    if (ticks() != before && latency > wakeMax) wakeMax = latency;
+}
+
+uint32_t wallClock() { return millis() + clockOffset; }
+
+void adjustClock(int32_t adjust) { clockOffset += (uint32_t) adjust; }
+
+void setTickHook(void (*hook)()) { tickHook = hook; }
+
+void setFrameHook(void (*hook)()) { frameHook = hook; }
+
+void frameSync() {
+    frames++;
+    if (!firstFrame) firstFrame = bootTime();
+    if (frameHook) frameHook();
+}
+
+void commandSync() {
+    if (!firstCommand) firstCommand = bootTime();
+}
+
+uint8_t taskCount() { return tableSize; }
+
+const task_stats_t &taskStats(uint8_t task) { return stats[task]; }
+
+uint16_t shownFrames() { return frames; }
+
+uint32_t idleTime() { return idleSum; }
+
+uint16_t maxWakeLatency() { return wakeMax; }
+
+uint16_t firstFrameTime() { return firstFrame; }
+
+uint16_t firstCommandTime() { return firstCommand; }
+
+void resetTaskStats() {
+    memset(stats, 0, sizeof(stats));
+    frames = 0;
+    idleSum = 0;
+    wakeMax = 0;
+}
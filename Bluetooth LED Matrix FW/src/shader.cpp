@@ -0,0 +1,306 @@
+#include "shader.h"
+#include "color.h"
+#include "config.h"
+#include "effects.h"
+#include "tables.h"
+
+using L = MatrixLayout;
+
+constexpr uint8_t HEADER_SIZE = 3; ///< The size of the header of the program.
+
+/**
+ * @struct shader_t
+ * @brief The program loaded from the EEPROM, stored in the scratch memory of the effects.
+ */
+struct shader_t {
+    color_t palette[SHADER_MAX_COLORS]; ///< The colors of the palette.
+    uint8_t code[SHADER_MAX_CODE]; ///< The code.
+    uint8_t colors; ///< The size of the palette.
+    uint8_t size; ///< The number of bytes of code.
+    bool valid; ///< False if there is no valid program.
+    bool cleared; ///< True once the LEDs have been cleared as there is no valid program.
+};
+
+static_assert(sizeof(shader_t) <= EFFECT_SCRATCH_SIZE, "the program must fit into the scratch memory of the effects");
+static_assert(HEADER_SIZE + SHADER_MAX_COLORS * 3 + SHADER_MAX_CODE <= SHADER_SIZE,
+              "the EEPROM region must hold a program of the maximum size");
+
+/**
+ * @struct op_info_t
+ * @brief The properties of an instruction used to validate a program.
+ */
+struct op_info_t {
+    uint8_t pops; ///< The number of values popped from the stack.
+    uint8_t pushes; ///< The number of values pushed onto the stack.
+    uint8_t immediate; ///< The number of bytes of code following the instruction.
+    uint16_t cycles; ///< An estimate of the CPU cycles the instruction takes including its dispatch.
+};
+
+/// The properties of the instructions, indexed by their code. The assembler of the app uses the same estimates.
+static const op_info_t OPS[SHADER_OP_COUNT] PROGMEM = {
+        {0, 1, 1, 20}, // PUSH
+        {0, 1, 0, 16}, // X
+        {0, 1, 0, 16}, // Y
+        {0, 1, 0, 16}, // T
+        {0, 1, 0, 16}, // I
+        {0, 1, 1, 20}, // ARG
+        {1, 2, 0, 16}, // DUP
+        {2, 2, 0, 18}, // SWAP
+        {1, 0, 0, 12}, // DROP
+        {2, 3, 0, 16}, // OVER
+        {2, 1, 0, 18}, // ADD
+        {2, 1, 0, 18}, // SUB
+        {2, 1, 0, 20}, // MUL
+        {2, 1, 0, 24}, // SCALE
+        {2, 1, 0, 18}, // AND
+        {2, 1, 0, 18}, // OR
+        {2, 1, 0, 18}, // XOR
+        {2, 1, 0, 20}, // MIN
+        {2, 1, 0, 20}, // MAX
+        {2, 1, 0, 20}, // LT
+        {2, 1, 0, 20}, // EQ
+        {2, 1, 0, 22}, // QADD
+        {2, 1, 0, 22}, // QSUB
+        {1, 1, 1, 48}, // SHL
+        {1, 1, 1, 48}, // SHR
+        {1, 1, 0, 16}, // NOT
+        {1, 1, 0, 22}, // SIN
+        {1, 1, 0, 22}, // COS
+        {2, 1, 0, 420}, // NOISE
+        {1, 0, 1, 20}, // JZ
+        {0, 0, 1, 16}, // JMP
+        {3, 0, 0, 24}, // RGB
+        {1, 0, 0, 60}, // HUE
+        {1, 0, 0, 140}, // PAL
+};
+
+
+/**
+ * @brief Read a byte of the program from the EEPROM.
+ *
+ * @param offset The offset from the start of the program.
+ * @return The byte.
+ */
+static uint8_t readByte(uint16_t offset) { return eeprom_read_byte(eepromPtr(SHADER_ADDR + offset)); }
+
+/**
+ * @brief Read the length of the program from the EEPROM.
+ *
+ * @return The number of bytes of the whole program.
+ */
+static uint16_t readLength() { return (uint16_t) readByte(0) << 8 | readByte(1); }
+
+/**
+ * @brief Read the properties of an instruction from the flash memory.
+ *
+ * @param op The code of the instruction.
+ * @return The properties of the instruction.
+ */
+static op_info_t getOp(uint8_t op) {
+    op_info_t info;
+    memcpy_P(&info, &OPS[op], sizeof(op_info_t));
+    return info;
+}
+
+/**
+ * @brief Check that the program in the EEPROM only contains valid instructions and fits into the budget.
+ *
+ * The depth of the stack is followed through the code; as jumps only go forward, the depth at every jump target
+ * is known before the target is reached, and it must be the same on every path leading there.
+ * A jump target must be the start of an instruction or the end of the code.
+ * Every instruction runs at most once per pixel, so the sum of their cycles is the worst case of a pixel.
+ *
+ * @return True if the program can be run without any checks.
+ */
+static bool validate() {
+    uint16_t length = readLength();
+    uint8_t colors = readByte(2);
+    uint16_t start = HEADER_SIZE + colors * 3;
+    if (length > SHADER_SIZE || colors > SHADER_MAX_COLORS || length <= start || length - start > SHADER_MAX_CODE) {
+        return false;
+    }
+    auto size = (uint8_t) (length - start);
+
+    int8_t depths[SHADER_MAX_CODE + 1]; // the depth of the stack at every jump target, -1 if there is none
+    memset(depths, -1, sizeof(depths));
+    int8_t depth = 0; // -1 while the code is only reachable by a jump
+    uint32_t cycles = SHADER_PIXEL_CYCLES;
+    for (uint8_t pc = 0; pc < size;) {
+        if (depth < 0) depth = depths[pc];
+        else if (depths[pc] >= 0 && depths[pc] != depth) return false;
+
+        uint8_t op = readByte(start + pc);
+        if (op >= SHADER_OP_COUNT) return false;
+        op_info_t info = getOp(op);
+        if (pc + info.immediate >= size) return false;
+        // a jump into the immediate would run it as instruction, and jumps only go forward, so it is known by now
+        if (info.immediate && depths[pc + 1] >= 0) return false;
+        uint8_t imm = info.immediate ? readByte(start + pc + 1) : 0;
+        pc += 1 + info.immediate;
+        cycles += info.cycles;
+
+        if (depth >= 0) {
+            if (depth < info.pops || depth - info.pops + info.pushes > SHADER_STACK_SIZE) return false;
+            depth = (int8_t) (depth - info.pops + info.pushes);
+        }
+        switch (static_cast<op_t>(op)) {
+            case op_t::ARG:
+                if (imm >= EFFECT_MAX_PARAMS) return false;
+                break;
+            case op_t::SHL:
+            case op_t::SHR:
+                if (imm > 7) return false;
+                break;
+            case op_t::PAL:
+                if (colors == 0) return false;
+                break;
+            case op_t::JZ:
+            case op_t::JMP:
+                if (pc + imm > size) return false;
+                if (depth >= 0) {
+                    if (depths[pc + imm] >= 0 && depths[pc + imm] != depth) return false;
+                    depths[pc + imm] = depth;
+                }
+                if (op == static_cast<uint8_t>(op_t::JMP)) depth = -1;
+                break;
+            default:
+                break;
+        }
+    }
+    return cycles * Matrix::LED_COUNT <= SHADER_CYCLE_BUDGET;
+}
+
+/**
+ * @brief Look up a position of the palette, blending between its two nearest colors.
+ *
+ * @param shader The program.
+ * @param v The position, the palette is spread evenly over [0, 255] and wraps around.
+ * @return The color at the position.
+ */
+static color_t palette(const shader_t &shader, uint8_t v) {
+    uint16_t pos = (uint16_t) v * shader.colors;
+    uint8_t i = pos >> 8;
+    uint8_t next = i + 1 < shader.colors ? i + 1 : 0;
+    return color_t::lerp(shader.palette[i], shader.palette[next], (uint8_t) pos);
+}
+
+/**
+ * @brief Run the program for a pixel.
+ *
+ * @param shader The validated program.
+ * @param x The column of the pixel.
+ * @param y The row of the pixel.
+ * @param t The time in units of 16 ms.
+ * @param i The low byte of the logical number of the pixel.
+ * @param params The parameters of the effect.
+ * @return The color of the pixel.
+ */
+static color_t run(const shader_t &shader, uint8_t x, uint8_t y, uint8_t t, uint8_t i, const uint8_t *params) {
+    uint8_t stack[SHADER_STACK_SIZE];
+    uint8_t *sp = stack; // the next free slot
+    color_t out;
+    const uint8_t *pc = shader.code;
+    const uint8_t *end = shader.code + shader.size;
+    while (pc < end) {
+        auto op = static_cast<op_t>(*pc++);
+        if (op >= op_t::ADD && op <= op_t::QSUB) {
+            uint8_t b = *--sp;
+            uint8_t &a = sp[-1];
+            switch (op) {
+                case op_t::ADD: a += b; break;
+                case op_t::SUB: a -= b; break;
+                case op_t::MUL: a *= b; break;
+                case op_t::SCALE: a = scale8(a, b); break;
+                case op_t::AND: a &= b; break;
+                case op_t::OR: a |= b; break;
+                case op_t::XOR: a ^= b; break;
+                case op_t::MIN: a = a < b ? a : b; break;
+                case op_t::MAX: a = a > b ? a : b; break;
+                case op_t::LT: a = a < b ? 255 : 0; break;
+                case op_t::EQ: a = a == b ? 255 : 0; break;
+                case op_t::QADD: a = a > 255 - b ? 255 : a + b; break;
+                case op_t::QSUB: a = a > b ? a - b : 0; break;
+                default: break;
+            }
+            continue;
+        }
+        switch (op) {
+            case op_t::PUSH: *sp++ = *pc++; break;
+            case op_t::X: *sp++ = x; break;
+            case op_t::Y: *sp++ = y; break;
+            case op_t::T: *sp++ = t; break;
+            case op_t::I: *sp++ = i; break;
+            case op_t::ARG: *sp++ = params[*pc++]; break;
+            case op_t::DUP: *sp = sp[-1]; sp++; break;
+            case op_t::SWAP: {
+                uint8_t a = sp[-2];
+                sp[-2] = sp[-1];
+                sp[-1] = a;
+                break;
+            }
+            case op_t::DROP: sp--; break;
+            case op_t::OVER: *sp = sp[-2]; sp++; break;
+            case op_t::SHL: sp[-1] <<= *pc++; break;
+            case op_t::SHR: sp[-1] >>= *pc++; break;
+            case op_t::NOT: sp[-1] = 255 - sp[-1]; break;
+            case op_t::SIN: sp[-1] = sin8(sp[-1]); break;
+            case op_t::COS: sp[-1] = cos8(sp[-1]); break;
+            case op_t::NOISE:
+                sp--;
+                sp[-1] = noise8((uint16_t) sp[-1] << 4, (uint16_t) sp[0] << 4);
+                break;
+            case op_t::JZ: {
+                uint8_t skip = *pc++;
+                if (*--sp == 0) pc += skip;
+                break;
+            }
+            case op_t::JMP: pc += *pc + 1; break;
+            case op_t::RGB:
+                sp -= 3;
+                out = {sp[0], sp[1], sp[2]};
+                break;
+            case op_t::HUE: out = color_t::wheel(*--sp); break;
+            case op_t::PAL: out = palette(shader, *--sp); break;
+            default: break;
+        }
+    }
+    return out;
+}
+
+
+state_t writeShader(uint16_t offset, const uint8_t *data, uint8_t count) {
+    if (count > STORAGE_CHUNK_SIZE || (uint32_t) offset + count > SHADER_SIZE) return state_t::INVALID_ARGUMENT;
+    eeprom_update_block(data, eepromPtr(SHADER_ADDR + offset), count);
+    if ((uint32_t) offset + count < readLength()) return state_t::OK; // more chunks follow
+    return validate() ? state_t::OK : state_t::INVALID_ARGUMENT;
+}
+
+void shaderInit(Adafruit_NeoPixel &, const uint8_t *, uint8_t *scratch) {
+    auto &shader = *reinterpret_cast<shader_t *>(scratch);
+    shader.cleared = false;
+    shader.valid = validate();
+    if (!shader.valid) return;
+    shader.colors = readByte(2);
+    uint16_t start = HEADER_SIZE + shader.colors * 3;
+    shader.size = (uint8_t) (readLength() - start);
+    eeprom_read_block(shader.palette, eepromPtr(SHADER_ADDR + HEADER_SIZE), shader.colors * sizeof(color_t));
+    eeprom_read_block(shader.code, eepromPtr(SHADER_ADDR + start), shader.size);
+}
+
+bool shaderRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *params, uint8_t *scratch) {
+    auto &shader = *reinterpret_cast<shader_t *>(scratch);
+    if (!shader.valid) {
+        if (shader.cleared) return false;
+        leds.clear();
+        shader.cleared = true;
+        return true;
+    }
+    auto ticks = (uint8_t) (t >> 4);
+    for (uint8_t y = 0; y < L::HEIGHT; y++) {
+        for (uint8_t x = 0; x < L::WIDTH; x++) {
+            color_t c = run(shader, x, y, ticks, (uint8_t) (y * L::WIDTH + x), params);
+            leds.setPixelColor(L::xy(x, y), c.r, c.g, c.b);
+        }
+    }
+    return true;
+}
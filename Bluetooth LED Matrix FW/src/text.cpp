@@ -0,0 +1,62 @@
+#include "text.h"
+#include "color.h"
+#include "config.h"
+#include "effects.h"
+#include "font.h"
+#include "render.h"
+
+using L = MatrixLayout;
+
+/**
+ * @struct scroll_t
+ * @brief The state of the scrolling text, stored in the scratch memory of the effects.
+ */
+struct scroll_t {
+    uint16_t column; ///< The column of the text that enters the matrix at the next step.
+    uint32_t lastStep; ///< The time of the last step in milliseconds.
+};
+
+static_assert(sizeof(scroll_t) <= EFFECT_SCRATCH_SIZE, "the state must fit into the scratch memory of the effects");
+
+constexpr uint8_t GLYPH_STEP = FONT_WIDTH + 1; ///< The columns of a glyph including the space to the next one.
+constexpr uint8_t TOP = L::HEIGHT > FONT_HEIGHT ? (L::HEIGHT - FONT_HEIGHT) / 2 : 0; ///< The row of the top of the text.
+
+static char text[TEXT_MAX_LENGTH] = "Hello!"; ///< The characters of the text.
+static uint8_t textLength = 6; ///< The number of characters of the text.
+
+
+bool setText(const char *chars, uint8_t length) {
+    if (length > TEXT_MAX_LENGTH) return false;
+    memcpy(text, chars, length);
+    textLength = length;
+    return true;
+}
+
+void textInit(Adafruit_NeoPixel &leds, const uint8_t *, uint8_t *scratch) {
+    auto &scroll = *reinterpret_cast<scroll_t *>(scratch);
+    scroll.column = 0;
+    scroll.lastStep = 0;
+    leds.clear();
+}
+
+bool textRender(Adafruit_NeoPixel &leds, uint32_t t, const uint8_t *params, uint8_t *scratch) {
+    auto &scroll = *reinterpret_cast<scroll_t *>(scratch);
+    uint16_t stepTime = (params[3] ? params[3] : 8) * 10;
+    if (t - scroll.lastStep < stepTime) return false;
+    scroll.lastStep = t;
+
+    color_t color = (params[0] | params[1] | params[2]) ? color_t(params[0], params[1], params[2]) : color_t(255, 255, 255);
+    shiftPixels(leds, -1, 0, false, color_t());
+
+    // the text is followed by a blank matrix width, so it scrolls out completely before it starts again
+    uint8_t bits = 0;
+    uint8_t glyph = scroll.column / GLYPH_STEP;
+    uint8_t column = scroll.column % GLYPH_STEP;
+    if (glyph < textLength && column < FONT_WIDTH) bits = fontColumn(text[glyph], column);
+    for (uint8_t y = 0; y < FONT_HEIGHT && TOP + y < L::HEIGHT; y++) {
+        if (bits >> y & 1) leds.setPixelColor(L::xy(L::WIDTH - 1, TOP + y), color.r, color.g, color.b);
+    }
+
+    if (++scroll.column >= (uint16_t) textLength * GLYPH_STEP + L::WIDTH) scroll.column = 0;
+    return true;
+}